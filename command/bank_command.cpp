@@ -0,0 +1,260 @@
+// Reference:
+// Klaus Iglberg.
+// C++ Software Design.
+// Design principles and patterns for high-quality software.
+
+// The same commands applied to many calculators at once.
+
+#include <iostream>
+#include <vector>
+#include <variant>
+#include <memory>
+#include <span>
+#include <random>
+#include <chrono>
+#include <cstdint>
+#include <stdexcept>
+
+// classic interface, kept for user-defined commands
+class CalculatorCommand
+{
+	public:
+	virtual ~CalculatorCommand() = default;
+	virtual int execute(int i) const = 0;
+	virtual int undo(int i) const = 0;
+};
+
+class Add
+{
+	public:
+	explicit Add(int operand) : operand_{operand} {}
+	int execute(int i) const { return i + operand_; }
+	int undo(int i) const { return i - operand_; }
+	int operand() const { return operand_; }
+	private:
+	int operand_;
+};
+
+class Subtract
+{
+	public:
+	explicit Subtract(int operand) : operand_{operand} {}
+	int execute(int i) const { return i - operand_; }
+	int undo(int i) const { return i + operand_; }
+	int operand() const { return operand_; }
+	private:
+	int operand_;
+};
+
+using Command = std::variant<Add, Subtract, std::unique_ptr<CalculatorCommand>>;
+
+// one byte per calculator, nonzero selects it and 0 leaves it alone
+using Mask = std::vector<std::uint8_t>;
+
+class SharedMask
+{	// immutable once made, so a mask kept in the history for undo selects the same calculators as for compute
+	// copies share the bytes; an empty SharedMask selects every calculator
+	public:
+	SharedMask() = default;
+	explicit SharedMask(Mask mask) : mask_{std::make_shared<const Mask>(std::move(mask))} {}
+	const Mask* get() const { return mask_.get(); }
+	const Mask& operator*() const { return *mask_; }
+	private:
+	std::shared_ptr<const Mask> mask_;
+};
+
+// kernels over the whole bank, written as plain loops without branches so that the compiler vectorizes them
+// the arithmetic is unsigned, so it wraps around instead of overflowing
+void shift(std::span<int> results, unsigned delta)
+{
+	for(int& result : results) { result = static_cast<int>(static_cast<unsigned>(result) + delta); }
+}
+
+void shift(std::span<int> results, unsigned delta, const Mask& mask)
+{
+	const std::uint8_t* selected = mask.data();
+	for(std::size_t i = 0; i < results.size(); ++i)
+	{
+		// any nonzero byte selects, as in transform
+		results[i] = static_cast<int>(static_cast<unsigned>(results[i]) + (delta & (0u - static_cast<unsigned>(selected[i] != 0))));
+	}
+}
+
+void shift(std::span<int> results, unsigned delta, const Mask* mask)
+{
+	if(mask == nullptr) shift(results, delta);
+	else shift(results, delta, *mask);
+}
+
+// user-defined commands are applied one calculator at a time
+template<class Function>
+void transform(std::span<int> results, const Mask* mask, Function function)
+{
+	if(mask == nullptr) { for(int& result : results) { result = function(result); } return; }
+	for(std::size_t i = 0; i < results.size(); ++i) { if((*mask)[i] != 0) results[i] = function(results[i]); }
+}
+
+struct Execute
+{
+	std::span<int> results;
+	const Mask* mask;
+	void operator()(const Add& add) const { shift(results, static_cast<unsigned>(add.operand()), mask); }
+	void operator()(const Subtract& subtract) const { shift(results, 0u - static_cast<unsigned>(subtract.operand()), mask); }
+	void operator()(const std::unique_ptr<CalculatorCommand>& command) const { transform(results, mask, [&](int i) { return command->execute(i); }); }
+};
+
+struct Undo
+{
+	std::span<int> results;
+	const Mask* mask;
+	void operator()(const Add& add) const { shift(results, 0u - static_cast<unsigned>(add.operand()), mask); }
+	void operator()(const Subtract& subtract) const { shift(results, static_cast<unsigned>(subtract.operand()), mask); }
+	void operator()(const std::unique_ptr<CalculatorCommand>& command) const { transform(results, mask, [&](int i) { return command->undo(i); }); }
+};
+
+class CalculatorBank
+{	// the results of many calculators side by side, sharing a single history
+	// a command is applied to all of them, or only to the ones selected by a mask
+	public:
+	explicit CalculatorBank(std::size_t size) : current_(size, 0) {}
+	void compute(Command command) { compute(std::move(command), SharedMask{}); }
+	// the mask is kept in the history for undo, so it may be shared by several commands
+	void compute(Command, SharedMask);
+	// undoes the last command on the calculators it was applied to
+	void undo_last();
+	int result(std::size_t calculator) const { return current_[calculator]; }
+	std::span<const int> results() const { return current_; }
+	std::size_t size() const { return current_.size(); }
+	void clear();
+	private:
+	struct Entry
+	{
+		Command command;
+		SharedMask mask;
+	};
+	using CommandHistory = std::vector<Entry>;
+	std::vector<int> current_;
+	CommandHistory history_;
+};
+
+void CalculatorBank::compute(Command command, SharedMask mask)
+{
+	if(mask.get() != nullptr && mask.get()->size() != current_.size()) throw std::invalid_argument("mask size differs from the number of calculators");
+	std::visit(Execute{current_, mask.get()}, command);
+	history_.push_back(Entry{std::move(command), std::move(mask)});
+}
+
+void CalculatorBank::undo_last()
+{
+	if(history_.empty() == true) return;
+	const Entry& last = history_.back();
+	std::visit(Undo{current_, last.mask.get()}, last.command);
+	history_.pop_back();
+}
+
+void CalculatorBank::clear()
+{
+	current_.assign(current_.size(), 0);
+	CommandHistory{}.swap(history_);
+}
+
+class Calculator
+{	// same as in variant_command.cpp, one per account as the baseline
+	public:
+	void compute(Command command)
+	{
+		current_ = std::visit([this](const auto& command) { return execute(command); }, command);
+		history_.push_back(std::move(command));
+	}
+	void undo_last()
+	{
+		if(history_.empty() == true) return;
+		current_ = std::visit([this](const auto& command) { return undo(command); }, history_.back());
+		history_.pop_back();
+	}
+	int result() const { return current_; }
+	std::size_t history_size() const { return history_.size(); }
+	private:
+	int execute(const auto& command) const { return command.execute(current_); }
+	int execute(const std::unique_ptr<CalculatorCommand>& command) const { return command->execute(current_); }
+	int undo(const auto& command) const { return command.undo(current_); }
+	int undo(const std::unique_ptr<CalculatorCommand>& command) const { return command->undo(current_); }
+	int current_ = 0;
+	std::vector<Command> history_;
+};
+
+class Multiply : public CalculatorCommand
+{
+	public:
+	explicit Multiply(int operand) : operand_{operand} {}
+	virtual int execute(int i) const override { return i * operand_; }
+	virtual int undo(int i) const override { return i / operand_; }
+	private:
+	int operand_;
+};
+
+template<class Function>
+double elapsed_ms(Function function)
+{
+	const auto start = std::chrono::steady_clock::now();
+	function();
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main()
+{
+	CalculatorBank bank{4};
+	const SharedMask odd{Mask{0, 1, 0, 2}};
+	bank.compute(Add{3});
+	bank.compute(Add{7}, odd);
+	bank.compute(std::make_unique<Multiply>(2));
+	bank.compute(Subtract{4}, odd);
+	bank.compute(Subtract{2});
+	bank.undo_last();
+	for(int result : bank.results()) { std::cout << result << " "; }
+	std::cout << "\n";
+
+	// 2^20 accounts, 16 commands of which every other one is applied to a random half of the accounts, then all undone
+	constexpr std::size_t accounts = 1 << 20;
+	constexpr int commands = 16;
+	std::mt19937 engine{41};
+	std::bernoulli_distribution coin{0.5};
+	Mask coins(accounts);
+	for(auto& selected : coins) { selected = coin(engine); }
+	const SharedMask half{std::move(coins)};
+
+	std::vector<Calculator> calculators(accounts);
+	const double calculators_compute_ms = elapsed_ms([&] {
+		for(int c = 0; c < commands; ++c)
+		{
+			for(std::size_t a = 0; a < accounts; ++a)
+			{
+				if(c % 2 == 1 && (*half)[a] == 0) continue;
+				if(c % 4 < 2) calculators[a].compute(Add{c + 1});
+				else calculators[a].compute(Subtract{c});
+			}
+		}
+	});
+	long long calculators_checksum = 0;
+	for(const auto& calculator : calculators) { calculators_checksum += calculator.result(); }
+	const double calculators_undo_ms = elapsed_ms([&] { for(auto& calculator : calculators) { while(calculator.history_size() != 0) { calculator.undo_last(); } } });
+
+	CalculatorBank accounts_bank{accounts};
+	const double bank_compute_ms = elapsed_ms([&] {
+		for(int c = 0; c < commands; ++c)
+		{
+			const SharedMask mask = c % 2 == 1 ? half : SharedMask{};
+			if(c % 4 < 2) accounts_bank.compute(Add{c + 1}, mask);
+			else accounts_bank.compute(Subtract{c}, mask);
+		}
+	});
+	long long bank_checksum = 0;
+	for(int result : accounts_bank.results()) { bank_checksum += result; }
+	const double bank_undo_ms = elapsed_ms([&] { for(int c = 0; c < commands; ++c) { accounts_bank.undo_last(); } });
+	long long remaining = 0;
+	for(int result : accounts_bank.results()) { remaining += result != 0; }
+
+	std::cout << "vector of Calculator: compute " << calculators_compute_ms << " ms, undo " << calculators_undo_ms << " ms, checksum " << calculators_checksum << "\n";
+	std::cout << "CalculatorBank      : compute " << bank_compute_ms << " ms, undo " << bank_undo_ms << " ms, checksum " << bank_checksum << (remaining == 0 ? "" : " (undo incomplete)") << "\n";
+	return 0;
+}
@@ -0,0 +1,255 @@
+// Reference:
+// Klaus Iglberg.
+// C++ Software Design.
+// Design principles and patterns for high-quality software.
+
+// Calculator keeping only the most recent commands in a fixed-capacity ring buffer.
+
+#include <iostream>
+#include <array>
+#include <memory>
+#include <functional>
+#include <limits>
+#include <utility>
+#include <new>
+#include <cstdlib>
+#include <cstddef>
+
+// live heap bytes, to show that the memory of the history stays constant
+static std::size_t live_bytes = 0;
+
+void* operator new(std::size_t size)
+{	// the size is kept in front of the block, so that unsized delete can subtract it
+	auto* block = static_cast<std::max_align_t*>(std::malloc(size + sizeof(std::max_align_t)));
+	if(block == nullptr) throw std::bad_alloc{};
+	*reinterpret_cast<std::size_t*>(block) = size;
+	live_bytes += size;
+	return block + 1;
+}
+
+void operator delete(void* pointer) noexcept
+{
+	if(pointer == nullptr) return;
+	auto* block = static_cast<std::max_align_t*>(pointer) - 1;
+	live_bytes -= *reinterpret_cast<std::size_t*>(block);
+	std::free(block);
+}
+
+void operator delete(void* pointer, std::size_t) noexcept { operator delete(pointer); }
+
+template<class Type, std::size_t N>
+class CircularBuffer
+{	// same as in adapter/container_adapter.cpp, extended with popBack and the element count
+	public:
+	CircularBuffer() = default;
+	// the caller drops the front before pushing into a full buffer
+	void pushBack(Type element) { (*this)[in_++] = std::move(element); ++size_; }
+	// released elements are replaced by default constructed ones, so they free their memory now
+	Type popFront() { --size_; return std::exchange((*this)[out_++], Type{}); }
+	Type popBack() { --size_; return std::exchange((*this)[--in_], Type{}); }
+	std::size_t size() const { return size_; }
+	bool empty() const { return size_ == 0; }
+	bool full() const { return size_ == N; }
+	private:
+	class RangedInteger;
+	Type& operator[](const RangedInteger& at) { return elements_[at.value()]; }
+	RangedInteger in_;
+	RangedInteger out_;
+	std::size_t size_ = 0;
+	std::array<Type, N> elements_;
+};
+
+template<class Type, std::size_t N>
+class CircularBuffer<Type, N>::RangedInteger
+{
+	public:
+	RangedInteger() : value_{0} {}
+	std::size_t value() const { return value_; }
+	RangedInteger operator++(int);
+	RangedInteger& operator--();
+	private:
+	bool isSafeForIncrement() const { return (value_ + 1) != N; }
+	bool isSafeForDecrement() const { return value_ != 0; }
+	void wrapToBeginning() { value_ = 0; }
+	void wrapToEnd() { value_ = N - 1; }
+	std::size_t value_;
+};
+
+template<class Type, std::size_t N>
+typename CircularBuffer<Type, N>::RangedInteger CircularBuffer<Type, N>::RangedInteger::operator++(int)
+{
+	RangedInteger valueBeforeIncrement = *this;
+	if(isSafeForIncrement()) { ++value_; }
+	else { wrapToBeginning(); }
+	return valueBeforeIncrement;
+}
+
+template<class Type, std::size_t N>
+typename CircularBuffer<Type, N>::RangedInteger& CircularBuffer<Type, N>::RangedInteger::operator--()
+{
+	if(isSafeForDecrement()) { --value_; }
+	else { wrapToEnd(); }
+	return *this;
+}
+
+// classic commands, as in classic_command.cpp
+class CalculatorCommand
+{
+	public:
+	virtual ~CalculatorCommand() = default;
+	virtual int execute(int i) const = 0;
+	virtual int undo(int i) const = 0;
+	// memory owned by the command, counted by a history limited in bytes
+	virtual std::size_t bytes() const = 0;
+};
+
+class Add : public CalculatorCommand
+{
+	public:
+	explicit Add(int operand) : operand_{operand} {}
+	virtual int execute(int i) const override { return i + operand_; }
+	virtual int undo(int i) const override { return i - operand_; }
+	virtual std::size_t bytes() const override { return sizeof(*this); }
+	private:
+	int operand_;
+};
+
+class Subtract : public CalculatorCommand
+{
+	public:
+	explicit Subtract(int operand) : operand_{operand} {}
+	virtual int execute(int i) const override { return i - operand_; }
+	virtual int undo(int i) const override { return i + operand_; }
+	virtual std::size_t bytes() const override { return sizeof(*this); }
+	private:
+	int operand_;
+};
+
+using CommandPtrType = std::unique_ptr<CalculatorCommand>;
+
+int execute(const CommandPtrType& command, int i) { return command->execute(i); }
+int undo(const CommandPtrType& command, int i) { return command->undo(i); }
+std::size_t footprint(const CommandPtrType& command) { return sizeof(command) + command->bytes(); }
+
+// functional commands, as in functional_command.cpp
+// the members are not const, so that the ring buffer can overwrite them
+struct FunctionalCommand
+{
+	using function_type = std::function<int(int)>;
+	function_type execute;
+	function_type undo;
+};
+
+FunctionalCommand make_add(int operand)
+{
+	return FunctionalCommand{[operand](int i) { return i + operand; }, [operand](int i) { return i - operand; }};
+}
+
+FunctionalCommand make_subtract(int operand)
+{
+	return FunctionalCommand{[operand](int i) { return i - operand; }, [operand](int i) { return i + operand; }};
+}
+
+int execute(const FunctionalCommand& command, int i) { return command.execute(i); }
+int undo(const FunctionalCommand& command, int i) { return command.undo(i); }
+// small captures are stored inside std::function, without allocation
+std::size_t footprint(const FunctionalCommand&) { return sizeof(FunctionalCommand); }
+
+template<class Command, std::size_t N>
+class Calculator
+{	// keeps the last N commands, and no more than max_bytes of them; the oldest ones are dropped
+	// so undo_last can go back at most that far
+	public:
+	explicit Calculator(std::size_t max_bytes = std::numeric_limits<std::size_t>::max()) : max_bytes_{max_bytes} {}
+	void compute(Command);
+	void undo_last();
+	int result() const { return current_; }
+	void clear();
+	std::size_t history_size() const { return history_.size(); }
+	std::size_t history_bytes() const { return bytes_; }
+	// number of commands dropped from the history so far
+	std::size_t dropped() const { return dropped_; }
+	private:
+	void drop_oldest();
+	std::size_t max_bytes_;
+	std::size_t bytes_ = 0;
+	std::size_t dropped_ = 0;
+	int current_ = 0;
+	CircularBuffer<Command, N> history_;
+};
+
+template<class Command, std::size_t N>
+void Calculator<Command, N>::drop_oldest()
+{
+	bytes_ -= footprint(history_.popFront());
+	++dropped_;
+}
+
+template<class Command, std::size_t N>
+void Calculator<Command, N>::compute(Command command)
+{
+	current_ = execute(command, current_);
+	const std::size_t bytes = footprint(command);
+	if(bytes > max_bytes_)
+	{	// does not fit even into an empty history, so nothing before it can be undone either
+		while(!history_.empty()) { drop_oldest(); }
+		++dropped_;
+		return;
+	}
+	while(history_.full() || bytes_ + bytes > max_bytes_) { drop_oldest(); }
+	bytes_ += bytes;
+	history_.pushBack(std::move(command));
+}
+
+template<class Command, std::size_t N>
+void Calculator<Command, N>::undo_last()
+{
+	if(history_.empty() == true) return;
+	auto command = history_.popBack();
+	bytes_ -= footprint(command);
+	current_ = undo(command, current_);
+}
+
+template<class Command, std::size_t N>
+void Calculator<Command, N>::clear()
+{
+	current_ = 0;
+	while(!history_.empty()) { history_.popBack(); }
+	bytes_ = 0;
+}
+
+int main()
+{
+	Calculator<CommandPtrType, 3> calculator{};
+	calculator.compute(std::make_unique<Add>(3));
+	calculator.compute(std::make_unique<Add>(7));
+	calculator.compute(std::make_unique<Subtract>(4));
+	calculator.compute(std::make_unique<Subtract>(2));
+	// Add{3} has been dropped, only three commands can be undone
+	for(int i = 0; i < 4; ++i) { calculator.undo_last(); }
+	std::cout << calculator.result() << " after dropping " << calculator.dropped() << " command(s)\n";
+
+	Calculator<FunctionalCommand, 3> functional{};
+	functional.compute(make_add(3));
+	functional.compute(make_add(7));
+	functional.compute(make_subtract(4));
+	functional.compute(make_subtract(2));
+	functional.undo_last();
+	std::cout << functional.result() << "\n";
+
+	// an unbounded stream of commands, the heap does not grow
+	constexpr std::size_t slots = 4096;
+	auto by_count = std::make_unique<Calculator<CommandPtrType, slots>>();
+	auto by_bytes = std::make_unique<Calculator<CommandPtrType, slots>>(16 * 1024);
+	for(std::size_t i = 1; i <= 10000000; ++i)
+	{
+		if(i % 2 == 0) { by_count->compute(std::make_unique<Add>(1)); by_bytes->compute(std::make_unique<Add>(1)); }
+		else { by_count->compute(std::make_unique<Subtract>(1)); by_bytes->compute(std::make_unique<Subtract>(1)); }
+		if(i % 2500000 == 0)
+		{
+			std::cout << i << " commands: last " << slots << " commands kept " << by_count->history_size() << " (" << by_count->history_bytes() << " bytes), last 16 KiB kept "
+				<< by_bytes->history_size() << " (" << by_bytes->history_bytes() << " bytes), live heap " << live_bytes << " bytes\n";
+		}
+	}
+	return 0;
+}
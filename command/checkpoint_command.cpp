@@ -0,0 +1,187 @@
+// Reference:
+// Klaus Iglberg.
+// C++ Software Design.
+// Design principles and patterns for high-quality software.
+
+#include <iostream>
+#include <vector>
+#include <variant>
+#include <memory>
+#include <random>
+#include <chrono>
+#include <stdexcept>
+
+// classic interface, kept for user-defined commands
+class CalculatorCommand
+{
+	public:
+	virtual ~CalculatorCommand() = default;
+	virtual int execute(int i) const = 0;
+	virtual int undo(int i) const = 0;
+};
+
+class Add
+{
+	public:
+	explicit Add(int operand) : operand_{operand} {}
+	int execute(int i) const { return i + operand_; }
+	int undo(int i) const { return i - operand_; }
+	private:
+	int operand_;
+};
+
+class Subtract
+{
+	public:
+	explicit Subtract(int operand) : operand_{operand} {}
+	int execute(int i) const { return i - operand_; }
+	int undo(int i) const { return i + operand_; }
+	private:
+	int operand_;
+};
+
+using Command = std::variant<Add, Subtract, std::unique_ptr<CalculatorCommand>>;
+
+class Calculator
+{
+	public:
+	// the result is stored after every checkpoint_interval commands
+	explicit Calculator(std::size_t checkpoint_interval = 1024);
+	void compute(Command);
+	void undo_last();
+	// goes back to the state after the first index commands, discarding the rest
+	void undo_to(std::size_t index);
+	// result after the first index commands, state_at(history_size()) == result()
+	int state_at(std::size_t index) const;
+	int result() const { return current_; }
+	void clear();
+	std::size_t history_size() const { return history_.size(); }
+	std::size_t checkpoint_bytes() const { return checkpoints_.capacity() * sizeof(int); }
+	private:
+	using CommandHistory = std::vector<Command>;
+	std::size_t checkpoint_interval_;
+	int current_ = 0;
+	CommandHistory history_;
+	// checkpoints_[c] is the result after c * checkpoint_interval_ commands
+	std::vector<int> checkpoints_;
+};
+
+struct Execute
+{
+	int current;
+	int operator()(const auto& command) const { return command.execute(current); }
+	int operator()(const std::unique_ptr<CalculatorCommand>& command) const { return command->execute(current); }
+};
+
+struct Undo
+{
+	int current;
+	int operator()(const auto& command) const { return command.undo(current); }
+	int operator()(const std::unique_ptr<CalculatorCommand>& command) const { return command->undo(current); }
+};
+
+Calculator::Calculator(std::size_t checkpoint_interval) : checkpoint_interval_{checkpoint_interval}, checkpoints_{0}
+{
+	if(checkpoint_interval_ == 0) throw std::invalid_argument("checkpoint interval has to be positive");
+}
+
+void Calculator::compute(Command command)
+{
+	current_ = std::visit(Execute{current_}, command);
+	history_.push_back(std::move(command));
+	if(history_.size() % checkpoint_interval_ == 0) { checkpoints_.push_back(current_); }
+}
+
+void Calculator::undo_last()
+{
+	if(history_.empty() == true) return;
+	if(history_.size() % checkpoint_interval_ == 0) { checkpoints_.pop_back(); }
+	current_ = std::visit(Undo{current_}, history_.back());
+	history_.pop_back();
+}
+
+int Calculator::state_at(std::size_t index) const
+{	// replays at most checkpoint_interval_ - 1 commands from the nearest checkpoint before index
+	if(index > history_.size()) throw std::out_of_range("index is beyond the history");
+	const std::size_t checkpoint = index / checkpoint_interval_;
+	int state = checkpoints_[checkpoint];
+	for(std::size_t i = checkpoint * checkpoint_interval_; i < index; ++i)
+	{
+		state = std::visit(Execute{state}, history_[i]);
+	}
+	return state;
+}
+
+void Calculator::undo_to(std::size_t index)
+{	// replays forward instead of undoing backward, so it is exact even if undo of a command is not
+	current_ = state_at(index);
+	history_.erase(history_.begin() + index, history_.end());
+	checkpoints_.resize(index / checkpoint_interval_ + 1);
+}
+
+void Calculator::clear()
+{
+	current_ = 0;
+	CommandHistory{}.swap(history_);
+	checkpoints_.assign(1, 0);
+}
+
+class Multiply : public CalculatorCommand
+{
+	public:
+	explicit Multiply(int operand) : operand_{operand} {}
+	virtual int execute(int i) const override { return i * operand_; }
+	virtual int undo(int i) const override { return i / operand_; }
+	private:
+	int operand_;
+};
+
+template<class Function>
+double elapsed_us(Function function)
+{
+	const auto start = std::chrono::steady_clock::now();
+	function();
+	return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main()
+{
+	Calculator calculator{2};
+	calculator.compute(Add{3});
+	calculator.compute(Add{7});
+	calculator.compute(std::make_unique<Multiply>(2));
+	calculator.compute(Subtract{4});
+	calculator.compute(Subtract{2});
+	calculator.undo_last();
+	std::cout << calculator.result() << "\n";
+	std::cout << calculator.state_at(2) << "\n";
+	calculator.undo_to(1);
+	std::cout << calculator.result() << "\n";
+
+	// 10^6 commands, then random state_at queries and a single undo_to the beginning
+	constexpr std::size_t count = 1000000;
+	constexpr std::size_t queries = 1000;
+	for(std::size_t interval : {1, 16, 256, 4096, 65536})
+	{
+		Calculator long_running{interval};
+		for(std::size_t i = 0; i < count; ++i)
+		{
+			if(i % 2 == 0) long_running.compute(Add{static_cast<int>(i % 7)});
+			else long_running.compute(Subtract{static_cast<int>(i % 5)});
+		}
+		std::mt19937 engine{7};
+		std::uniform_int_distribution<std::size_t> index_of{0, count};
+		long long checksum = 0;
+		const double query_us = elapsed_us([&] { for(std::size_t q = 0; q < queries; ++q) { checksum += long_running.state_at(index_of(engine)); } }) / queries;
+		const double undo_to_us = elapsed_us([&] { long_running.undo_to(0); });
+		std::cout << "checkpoint every " << interval << " commands: " << long_running.checkpoint_bytes() / 1024.0 << " KiB of checkpoints, state_at " << query_us << " us, undo_to(0) " << undo_to_us << " us"
+			<< (long_running.result() == 0 ? "" : " (wrong result)") << "\n";
+	}
+
+	// baseline: going back 10^6 commands one undo at a time
+	Calculator stepwise{};
+	for(std::size_t i = 0; i < count; ++i) { stepwise.compute(Add{1}); }
+	const double stepwise_us = elapsed_us([&] { while(stepwise.history_size() != 0) { stepwise.undo_last(); } });
+	std::cout << "10^6 x undo_last: " << stepwise_us << " us\n";
+	return 0;
+}
@@ -0,0 +1,402 @@
+// Reference:
+// Klaus Iglberg.
+// C++ Software Design.
+// Design principles and patterns for high-quality software.
+
+// Calculator shared by many threads: commands are submitted to a queue and applied by a single thread.
+
+#include <iostream>
+#include <vector>
+#include <variant>
+#include <optional>
+#include <memory>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <future>
+#include <functional>
+#include <chrono>
+#include <stdexcept>
+#include <exception>
+
+template<class Type>
+class BoundedMpscQueue
+{	// lock-free ring buffer for many producers and a single consumer (D. Vyukov's bounded queue)
+	// every cell carries a sequence number telling whether it is ready to be written or read
+	public:
+	explicit BoundedMpscQueue(std::size_t capacity);
+	bool try_push(Type&&);
+	// consumer only
+	bool try_pop(Type&);
+	private:
+	struct Cell
+	{
+		std::atomic<std::size_t> sequence;
+		Type value;
+	};
+	std::size_t mask_;
+	std::unique_ptr<Cell[]> cells_;
+	// producers and consumer write to different cache lines
+	alignas(64) std::atomic<std::size_t> tail_{0};
+	alignas(64) std::size_t head_{0};
+};
+
+template<class Type>
+BoundedMpscQueue<Type>::BoundedMpscQueue(std::size_t capacity) : mask_{capacity - 1}, cells_{std::make_unique<Cell[]>(capacity)}
+{
+	if(capacity < 2 || (capacity & mask_) != 0) throw std::invalid_argument("capacity has to be a power of two");
+	for(std::size_t i = 0; i < capacity; ++i) { cells_[i].sequence.store(i, std::memory_order_relaxed); }
+}
+
+template<class Type>
+bool BoundedMpscQueue<Type>::try_push(Type&& value)
+{
+	std::size_t position = tail_.load(std::memory_order_relaxed);
+	Cell* cell;
+	for(;;)
+	{
+		cell = &cells_[position & mask_];
+		const std::size_t sequence = cell->sequence.load(std::memory_order_acquire);
+		const auto difference = static_cast<std::ptrdiff_t>(sequence) - static_cast<std::ptrdiff_t>(position);
+		if(difference == 0)
+		{	// cell is free, claim it
+			if(tail_.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) break;
+		}
+		else if(difference < 0) return false; // full
+		else position = tail_.load(std::memory_order_relaxed); // another producer claimed it
+	}
+	cell->value = std::move(value);
+	cell->sequence.store(position + 1, std::memory_order_release);
+	return true;
+}
+
+template<class Type>
+bool BoundedMpscQueue<Type>::try_pop(Type& value)
+{
+	Cell& cell = cells_[head_ & mask_];
+	if(cell.sequence.load(std::memory_order_acquire) != head_ + 1) return false; // empty
+	value = std::move(cell.value);
+	// free the cell for the producers of the next lap
+	cell.sequence.store(head_ + mask_ + 1, std::memory_order_release);
+	++head_;
+	return true;
+}
+
+// classic interface, kept for user-defined commands
+class CalculatorCommand
+{
+	public:
+	virtual ~CalculatorCommand() = default;
+	virtual int execute(int i) const = 0;
+	virtual int undo(int i) const = 0;
+};
+
+class Add
+{
+	public:
+	explicit Add(int operand) : operand_{operand} {}
+	int execute(int i) const { return i + operand_; }
+	int undo(int i) const { return i - operand_; }
+	private:
+	int operand_;
+};
+
+class Subtract
+{
+	public:
+	explicit Subtract(int operand) : operand_{operand} {}
+	int execute(int i) const { return i - operand_; }
+	int undo(int i) const { return i + operand_; }
+	private:
+	int operand_;
+};
+
+using Command = std::variant<Add, Subtract, std::unique_ptr<CalculatorCommand>>;
+
+class Calculator
+{	// not thread-safe, same as in variant_command.cpp
+	public:
+	void compute(Command);
+	void undo_last();
+	int result() const { return current_; }
+	void clear();
+	private:
+	using CommandHistory = std::vector<Command>;
+	int current_ = 0;
+	CommandHistory history_;
+};
+
+struct Execute
+{
+	int current;
+	int operator()(const auto& command) const { return command.execute(current); }
+	int operator()(const std::unique_ptr<CalculatorCommand>& command) const { return command->execute(current); }
+};
+
+struct Undo
+{
+	int current;
+	int operator()(const auto& command) const { return command.undo(current); }
+	int operator()(const std::unique_ptr<CalculatorCommand>& command) const { return command->undo(current); }
+};
+
+void Calculator::compute(Command command)
+{
+	current_ = std::visit(Execute{current_}, command);
+	history_.push_back(std::move(command));
+}
+
+void Calculator::undo_last()
+{
+	if(history_.empty() == true) return;
+	current_ = std::visit(Undo{current_}, history_.back());
+	history_.pop_back();
+}
+
+void Calculator::clear()
+{
+	current_ = 0;
+	CommandHistory{}.swap(history_);
+}
+
+class CalculatorService
+{	// many threads submit, a single thread applies the commands in batches to the calculator it owns
+	// commands of a thread are applied in the order they were submitted
+	public:
+	// error is null on success; otherwise the command threw it and the result is the unchanged one
+	// runs on the applier thread, an exception thrown by a completion has nobody to go to and is discarded
+	using Completion = std::function<void(int result, std::exception_ptr error)>;
+	explicit CalculatorService(std::size_t queue_capacity = 4096, std::size_t batch_size = 256);
+	~CalculatorService();
+	CalculatorService(const CalculatorService&) = delete;
+	CalculatorService& operator=(const CalculatorService&) = delete;
+	// the future or the completion receives the result right after the command, or the exception it threw
+	std::future<int> submit(Command);
+	void submit(Command, Completion);
+	std::future<int> submit_undo();
+	// blocks until every submitted request has been applied
+	void wait_idle() const;
+	private:
+	struct Request
+	{	// an empty command means undo
+		std::optional<Command> command;
+		std::variant<std::monostate, std::promise<int>, Completion> completion;
+	};
+	void push(Request);
+	void run();
+	void apply(Request&);
+	std::size_t batch_size_;
+	BoundedMpscQueue<Request> queue_;
+	alignas(64) std::atomic<std::size_t> submitted_{0};
+	alignas(64) std::atomic<std::size_t> applied_{0};
+	std::atomic<bool> sleeping_{false};
+	std::atomic<bool> stopping_{false};
+	Calculator calculator_;
+	std::thread applier_;
+};
+
+CalculatorService::CalculatorService(std::size_t queue_capacity, std::size_t batch_size) : batch_size_{batch_size}, queue_{queue_capacity}
+{
+	applier_ = std::thread{[this] { run(); }};
+}
+
+CalculatorService::~CalculatorService()
+{	// pending requests are applied before the thread stops
+	stopping_.store(true);
+	sleeping_.store(false);
+	sleeping_.notify_one();
+	applier_.join();
+}
+
+void CalculatorService::push(Request request)
+{
+	submitted_.fetch_add(1, std::memory_order_relaxed);
+	while(!queue_.try_push(std::move(request))) { std::this_thread::yield(); }
+	// pairs with the fence of the applier, one of them sees the other
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	if(sleeping_.load(std::memory_order_relaxed))
+	{
+		sleeping_.store(false, std::memory_order_relaxed);
+		sleeping_.notify_one();
+	}
+}
+
+std::future<int> CalculatorService::submit(Command command)
+{
+	std::promise<int> promise;
+	auto future = promise.get_future();
+	push(Request{std::move(command), std::move(promise)});
+	return future;
+}
+
+void CalculatorService::submit(Command command, Completion completion)
+{
+	push(Request{std::move(command), std::move(completion)});
+}
+
+std::future<int> CalculatorService::submit_undo()
+{
+	std::promise<int> promise;
+	auto future = promise.get_future();
+	push(Request{std::nullopt, std::move(promise)});
+	return future;
+}
+
+void CalculatorService::apply(Request& request)
+{	// a throwing command goes back to its submitter, the applier thread keeps running
+	// the calculator is left as it was, since compute and undo_last change nothing when execute or undo throws
+	std::exception_ptr error;
+	try
+	{
+		if(request.command.has_value()) { calculator_.compute(std::move(*request.command)); }
+		else { calculator_.undo_last(); }
+	}
+	catch(...) { error = std::current_exception(); }
+	const int result = calculator_.result();
+	if(auto* promise = std::get_if<std::promise<int>>(&request.completion))
+	{
+		if(error) promise->set_exception(error);
+		else promise->set_value(result);
+	}
+	else if(auto* completion = std::get_if<Completion>(&request.completion))
+	{
+		try { (*completion)(result, error); }
+		catch(...) {}
+	}
+}
+
+void CalculatorService::run()
+{
+	Request request;
+	for(;;)
+	{
+		std::size_t drained = 0;
+		while(drained < batch_size_ && queue_.try_pop(request))
+		{
+			apply(request);
+			request = Request{};
+			++drained;
+		}
+		if(drained > 0)
+		{	// published once per batch
+			applied_.fetch_add(drained, std::memory_order_release);
+			continue;
+		}
+		if(stopping_.load() && applied_.load(std::memory_order_relaxed) == submitted_.load()) return;
+		// nothing to do, sleep until a producer wakes us up
+		sleeping_.store(true, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		if(queue_.try_pop(request))
+		{
+			sleeping_.store(false, std::memory_order_relaxed);
+			apply(request);
+			request = Request{};
+			applied_.fetch_add(1, std::memory_order_release);
+			continue;
+		}
+		if(stopping_.load()) { sleeping_.store(false); continue; }
+		sleeping_.wait(true);
+	}
+}
+
+void CalculatorService::wait_idle() const
+{
+	while(applied_.load(std::memory_order_acquire) != submitted_.load(std::memory_order_acquire)) { std::this_thread::yield(); }
+}
+
+class Multiply : public CalculatorCommand
+{
+	public:
+	explicit Multiply(int operand) : operand_{operand} {}
+	virtual int execute(int i) const override { return i * operand_; }
+	virtual int undo(int i) const override { return i / operand_; }
+	private:
+	int operand_;
+};
+
+class Divide : public CalculatorCommand
+{
+	public:
+	explicit Divide(int operand) : operand_{operand} {}
+	virtual int execute(int i) const override
+	{
+		if(operand_ == 0) throw std::domain_error("division by zero");
+		return i / operand_;
+	}
+	virtual int undo(int i) const override { return i * operand_; }
+	private:
+	int operand_;
+};
+
+template<class Function>
+double elapsed_s(Function function)
+{
+	const auto start = std::chrono::steady_clock::now();
+	function();
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main()
+{
+	{
+		CalculatorService service{};
+		service.submit(Add{3});
+		service.submit(Add{7});
+		service.submit(std::make_unique<Multiply>(2));
+		service.submit(Subtract{4});
+		service.submit(Subtract{2}, [](int result, std::exception_ptr) { std::cout << "after subtracting 2: " << result << "\n"; });
+		std::cout << service.submit_undo().get() << "\n";
+		// the exception reaches the submitter, later commands are still applied
+		auto failed = service.submit(std::make_unique<Divide>(0));
+		try { failed.get(); }
+		catch(const std::exception& error) { std::cout << "failed: " << error.what() << "\n"; }
+		service.submit(std::make_unique<Divide>(0), [](int result, std::exception_ptr error) { std::cout << (error ? "failed" : "applied") << ", result still " << result << "\n"; });
+		// an exception thrown by a completion itself is discarded
+		service.submit(Add{0}, [](int, std::exception_ptr) { throw std::runtime_error("completion failed"); });
+		std::cout << service.submit(Add{1}).get() << "\n";
+	}
+
+	// throughput with 1 to 32 producers, against a mutex around compute
+	constexpr std::size_t total = 1 << 21;
+	for(std::size_t producers : {1, 2, 4, 8, 16, 32})
+	{
+		const std::size_t per_producer = total / producers;
+		std::atomic<long long> checksum{0};
+		Calculator locked_calculator;
+		std::mutex mutex;
+		const double locked_s = elapsed_s([&] {
+			std::vector<std::thread> threads;
+			for(std::size_t p = 0; p < producers; ++p)
+			{
+				threads.emplace_back([&] {
+					long long sum = 0;
+					for(std::size_t i = 0; i < per_producer; ++i)
+					{
+						std::lock_guard lock{mutex};
+						locked_calculator.compute(Add{1});
+						sum += locked_calculator.result();
+					}
+					checksum += sum;
+				});
+			}
+			for(auto& thread : threads) { thread.join(); }
+		});
+		CalculatorService service{};
+		const double service_s = elapsed_s([&] {
+			std::vector<std::thread> threads;
+			for(std::size_t p = 0; p < producers; ++p)
+			{
+				threads.emplace_back([&] {
+					for(std::size_t i = 0; i < per_producer; ++i)
+					{
+						service.submit(Add{1}, [&checksum](int result, std::exception_ptr) { checksum.fetch_add(result, std::memory_order_relaxed); });
+					}
+				});
+			}
+			for(auto& thread : threads) { thread.join(); }
+			service.wait_idle();
+		});
+		std::cout << producers << " producer(s): mutex " << per_producer * producers / locked_s / 1e6 << " M commands/s, queue " << per_producer * producers / service_s / 1e6 << " M commands/s\n";
+	}
+	return 0;
+}
@@ -0,0 +1,566 @@
+// Reference:
+// Klaus Iglberg.
+// C++ Software Design.
+// Design principles and patterns for high-quality software.
+
+// Calculator with coroutine interface: co_await calculator.compute_async(command).
+
+#include <iostream>
+#include <vector>
+#include <deque>
+#include <queue>
+#include <functional>
+#include <variant>
+#include <optional>
+#include <utility>
+#include <memory>
+#include <unordered_map>
+#include <coroutine>
+#include <exception>
+#include <stdexcept>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <latch>
+#include <chrono>
+#include <cstdint>
+
+template<class Type> class Task;
+
+class TaskPromiseBase
+{	// a task starts when it is awaited, and resumes its awaiter when it finishes
+	public:
+	struct FinalAwaiter
+	{
+		bool await_ready() const noexcept { return false; }
+		template<class Promise>
+		std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> finished) noexcept { return finished.promise().continuation_; }
+		void await_resume() const noexcept {}
+	};
+	std::suspend_always initial_suspend() const noexcept { return {}; }
+	FinalAwaiter final_suspend() const noexcept { return {}; }
+	void unhandled_exception() { exception_ = std::current_exception(); }
+	std::coroutine_handle<> continuation_ = std::noop_coroutine();
+	std::exception_ptr exception_;
+};
+
+template<class Type>
+class TaskPromise : public TaskPromiseBase
+{
+	public:
+	Task<Type> get_return_object();
+	void return_value(Type value) { value_ = std::move(value); }
+	Type result()
+	{
+		if(exception_) std::rethrow_exception(exception_);
+		return std::move(*value_);
+	}
+	private:
+	std::optional<Type> value_;
+};
+
+template<>
+class TaskPromise<void> : public TaskPromiseBase
+{
+	public:
+	Task<void> get_return_object();
+	void return_void() {}
+	void result() { if(exception_) std::rethrow_exception(exception_); }
+};
+
+template<class Type>
+class [[nodiscard]] Task
+{	// lazy coroutine returning Type to the coroutine awaiting it
+	public:
+	using promise_type = TaskPromise<Type>;
+	explicit Task(std::coroutine_handle<promise_type> handle) : handle_{handle} {}
+	Task(Task&& other) noexcept : handle_{std::exchange(other.handle_, nullptr)} {}
+	Task& operator=(Task&&) = delete;
+	~Task() { if(handle_) handle_.destroy(); }
+	bool await_ready() const noexcept { return false; }
+	// symmetric transfer, the awaiter is resumed by the final suspend of the task
+	std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiter) noexcept
+	{
+		handle_.promise().continuation_ = awaiter;
+		return handle_;
+	}
+	Type await_resume() { return handle_.promise().result(); }
+	private:
+	std::coroutine_handle<promise_type> handle_;
+};
+
+template<class Type>
+Task<Type> TaskPromise<Type>::get_return_object() { return Task<Type>{std::coroutine_handle<TaskPromise<Type>>::from_promise(*this)}; }
+
+inline Task<void> TaskPromise<void>::get_return_object() { return Task<void>{std::coroutine_handle<TaskPromise<void>>::from_promise(*this)}; }
+
+class Detached
+{	// fire and forget coroutine, starts at once and cleans up after itself
+	public:
+	struct promise_type
+	{
+		Detached get_return_object() const noexcept { return {}; }
+		std::suspend_never initial_suspend() const noexcept { return {}; }
+		std::suspend_never final_suspend() const noexcept { return {}; }
+		void return_void() const noexcept {}
+		void unhandled_exception() const noexcept { std::terminate(); }
+	};
+};
+
+class Executor
+{	// small thread pool resuming coroutines
+	public:
+	explicit Executor(std::size_t thread_count);
+	~Executor();
+	Executor(const Executor&) = delete;
+	Executor& operator=(const Executor&) = delete;
+	void post(std::coroutine_handle<>);
+	// co_await executor.schedule() continues on one of the threads of the executor
+	auto schedule()
+	{
+		struct Schedule
+		{
+			Executor& executor;
+			bool await_ready() const noexcept { return false; }
+			void await_suspend(std::coroutine_handle<> handle) const { executor.post(handle); }
+			void await_resume() const noexcept {}
+		};
+		return Schedule{*this};
+	}
+	private:
+	void run();
+	std::mutex mutex_;
+	std::condition_variable ready_;
+	std::deque<std::coroutine_handle<>> queue_;
+	bool stopping_ = false;
+	std::vector<std::thread> threads_;
+};
+
+Executor::Executor(std::size_t thread_count)
+{
+	for(std::size_t i = 0; i < thread_count; ++i) { threads_.emplace_back([this] { run(); }); }
+}
+
+Executor::~Executor()
+{	// queued coroutines are resumed before the threads stop
+	{
+		std::lock_guard lock{mutex_};
+		stopping_ = true;
+	}
+	ready_.notify_all();
+	for(auto& thread : threads_) { thread.join(); }
+}
+
+void Executor::post(std::coroutine_handle<> handle)
+{
+	{
+		std::lock_guard lock{mutex_};
+		queue_.push_back(handle);
+	}
+	ready_.notify_one();
+}
+
+void Executor::run()
+{
+	for(;;)
+	{
+		std::unique_lock lock{mutex_};
+		ready_.wait(lock, [this] { return stopping_ || !queue_.empty(); });
+		if(queue_.empty()) return;
+		const auto handle = queue_.front();
+		queue_.pop_front();
+		lock.unlock();
+		handle.resume();
+	}
+}
+
+class Storage
+{	// simulated local storage: a read completes after a fixed latency, without blocking a thread meanwhile
+	public:
+	Storage(Executor& executor, std::chrono::microseconds latency, std::vector<int> values);
+	~Storage();
+	Storage(const Storage&) = delete;
+	Storage& operator=(const Storage&) = delete;
+	class Read;
+	// int value = co_await storage.read(key), continues on the executor
+	Read read(std::size_t key);
+	// the same read, blocking the calling thread
+	int read_blocking(std::size_t key) const;
+	std::size_t size() const { return values_.size(); }
+	private:
+	struct Pending
+	{
+		std::chrono::steady_clock::time_point deadline;
+		Read* read;
+		std::coroutine_handle<> handle;
+		bool operator>(const Pending& other) const { return deadline > other.deadline; }
+	};
+	void start(Pending);
+	void run();
+	Executor& executor_;
+	std::chrono::microseconds latency_;
+	std::vector<int> values_;
+	std::mutex mutex_;
+	std::condition_variable changed_;
+	std::priority_queue<Pending, std::vector<Pending>, std::greater<>> pending_;
+	bool stopping_ = false;
+	std::thread timer_;
+};
+
+class Storage::Read
+{
+	public:
+	Read(Storage& storage, std::size_t key) : storage_{storage}, key_{key} {}
+	bool await_ready() const noexcept { return false; }
+	void await_suspend(std::coroutine_handle<> handle) { storage_.start(Pending{std::chrono::steady_clock::now() + storage_.latency_, this, handle}); }
+	int await_resume() const
+	{
+		if(error_) std::rethrow_exception(error_);
+		return value_;
+	}
+	private:
+	friend class Storage;
+	Storage& storage_;
+	std::size_t key_;
+	int value_ = 0;
+	std::exception_ptr error_;
+};
+
+Storage::Read Storage::read(std::size_t key) { return Read{*this, key}; }
+
+Storage::Storage(Executor& executor, std::chrono::microseconds latency, std::vector<int> values) : executor_{executor}, latency_{latency}, values_{std::move(values)}
+{
+	timer_ = std::thread{[this] { run(); }};
+}
+
+Storage::~Storage()
+{	// pending reads are completed first
+	{
+		std::lock_guard lock{mutex_};
+		stopping_ = true;
+	}
+	changed_.notify_one();
+	timer_.join();
+}
+
+int Storage::read_blocking(std::size_t key) const
+{
+	std::this_thread::sleep_for(latency_);
+	return values_.at(key);
+}
+
+void Storage::start(Pending pending)
+{
+	{
+		std::lock_guard lock{mutex_};
+		pending_.push(pending);
+	}
+	changed_.notify_one();
+}
+
+void Storage::run()
+{
+	std::unique_lock lock{mutex_};
+	for(;;)
+	{
+		if(pending_.empty())
+		{
+			if(stopping_) return;
+			changed_.wait(lock);
+			continue;
+		}
+		const Pending next = pending_.top();
+		if(std::chrono::steady_clock::now() < next.deadline)
+		{
+			changed_.wait_until(lock, next.deadline);
+			continue;
+		}
+		pending_.pop();
+		// the awaiter lives in the suspended coroutine, so it can be written before resuming it;
+		// a failed read is rethrown in the awaiting coroutine rather than on this thread
+		try { next.read->value_ = values_.at(next.read->key_); }
+		catch(...) { next.read->error_ = std::current_exception(); }
+		executor_.post(next.handle);
+	}
+}
+
+// classic interface, kept for user-defined commands
+class CalculatorCommand
+{
+	public:
+	virtual ~CalculatorCommand() = default;
+	// slow commands fetch what they need here, before they are executed; many loads run at the same time
+	virtual Task<void> load() { co_return; }
+	virtual int execute(int i) const = 0;
+	virtual int undo(int i) const = 0;
+};
+
+class Add
+{
+	public:
+	explicit Add(int operand) : operand_{operand} {}
+	int execute(int i) const { return i + operand_; }
+	int undo(int i) const { return i - operand_; }
+	private:
+	int operand_;
+};
+
+class Subtract
+{
+	public:
+	explicit Subtract(int operand) : operand_{operand} {}
+	int execute(int i) const { return i - operand_; }
+	int undo(int i) const { return i + operand_; }
+	private:
+	int operand_;
+};
+
+using Command = std::variant<Add, Subtract, std::unique_ptr<CalculatorCommand>>;
+
+struct Execute
+{
+	int current;
+	int operator()(const auto& command) const { return command.execute(current); }
+	int operator()(const std::unique_ptr<CalculatorCommand>& command) const { return command->execute(current); }
+};
+
+struct Undo
+{
+	int current;
+	int operator()(const auto& command) const { return command.undo(current); }
+	int operator()(const std::unique_ptr<CalculatorCommand>& command) const { return command->undo(current); }
+};
+
+class Calculator
+{	// a command gets its place in the order when compute_async is awaited; its load runs concurrently with others,
+	// but commands are executed, and undone, strictly in that order
+	// the awaiting coroutine is suspended until its own command has been applied and gets the result after it
+	public:
+	explicit Calculator(Executor& executor) : executor_{executor} {}
+	Task<int> compute_async(Command);
+	// undoes the last command applied before it in the order
+	Task<int> undo_async();
+	int result() const;
+	private:
+	class Turn;
+	std::uint64_t take_ticket();
+	// lets the next command in the order proceed
+	void finish();
+	using CommandHistory = std::vector<Command>;
+	Executor& executor_;
+	mutable std::mutex mutex_;
+	std::uint64_t next_ticket_ = 0;
+	std::uint64_t applied_ = 0;
+	// coroutines waiting for their turn, by ticket
+	std::unordered_map<std::uint64_t, std::coroutine_handle<>> waiting_;
+	int current_ = 0;
+	CommandHistory history_;
+};
+
+class Calculator::Turn
+{	// suspends until every command with a smaller ticket has been applied
+	public:
+	Turn(Calculator& calculator, std::uint64_t ticket) : calculator_{calculator}, ticket_{ticket} {}
+	bool await_ready() const noexcept { return false; }
+	bool await_suspend(std::coroutine_handle<> handle)
+	{
+		std::lock_guard lock{calculator_.mutex_};
+		if(calculator_.applied_ == ticket_) return false;
+		calculator_.waiting_.emplace(ticket_, handle);
+		return true;
+	}
+	void await_resume() const noexcept {}
+	private:
+	Calculator& calculator_;
+	std::uint64_t ticket_;
+};
+
+std::uint64_t Calculator::take_ticket()
+{
+	std::lock_guard lock{mutex_};
+	return next_ticket_++;
+}
+
+void Calculator::finish()
+{
+	std::coroutine_handle<> next;
+	{
+		std::lock_guard lock{mutex_};
+		++applied_;
+		if(auto waiting = waiting_.find(applied_); waiting != waiting_.end())
+		{
+			next = waiting->second;
+			waiting_.erase(waiting);
+		}
+	}
+	// resumed on the executor, not here, so that a long chain of commands does not grow the stack
+	if(next) executor_.post(next);
+}
+
+Task<int> Calculator::compute_async(Command command)
+{
+	const std::uint64_t ticket = take_ticket();
+	// a failed load or execute gives up the command, but not its turn, so the commands after it are not stuck
+	std::exception_ptr failure;
+	try
+	{
+		if(auto* user_command = std::get_if<std::unique_ptr<CalculatorCommand>>(&command)) { co_await (*user_command)->load(); }
+	}
+	catch(...) { failure = std::current_exception(); }
+	co_await Turn{*this, ticket};
+	int result;
+	{
+		std::lock_guard lock{mutex_};
+		if(!failure)
+		{
+			try
+			{
+				current_ = std::visit(Execute{current_}, command);
+				history_.push_back(std::move(command));
+			}
+			catch(...) { failure = std::current_exception(); }
+		}
+		result = current_;
+	}
+	finish();
+	if(failure) std::rethrow_exception(failure);
+	co_return result;
+}
+
+Task<int> Calculator::undo_async()
+{
+	const std::uint64_t ticket = take_ticket();
+	co_await Turn{*this, ticket};
+	int result;
+	std::exception_ptr failure;
+	{
+		std::lock_guard lock{mutex_};
+		if(history_.empty() == false)
+		{	// a command that cannot be undone stays the last one
+			try
+			{
+				current_ = std::visit(Undo{current_}, history_.back());
+				history_.pop_back();
+			}
+			catch(...) { failure = std::current_exception(); }
+		}
+		result = current_;
+	}
+	finish();
+	if(failure) std::rethrow_exception(failure);
+	co_return result;
+}
+
+int Calculator::result() const
+{
+	std::lock_guard lock{mutex_};
+	return current_;
+}
+
+class StoredAdd : public CalculatorCommand
+{	// adds an operand that has to be read from storage first
+	public:
+	StoredAdd(Storage& storage, std::size_t key) : storage_{storage}, key_{key} {}
+	virtual Task<void> load() override { operand_ = co_await storage_.read(key_); }
+	virtual int execute(int i) const override { return i + operand_; }
+	virtual int undo(int i) const override { return i - operand_; }
+	private:
+	Storage& storage_;
+	std::size_t key_;
+	int operand_ = 0;
+};
+
+class Divide : public CalculatorCommand
+{
+	public:
+	explicit Divide(int operand) : operand_{operand} {}
+	virtual int execute(int i) const override
+	{
+		if(operand_ == 0) throw std::domain_error("division by zero");
+		return i / operand_;
+	}
+	virtual int undo(int i) const override { return i * operand_; }
+	private:
+	int operand_;
+};
+
+Detached example(Executor& executor, Calculator& calculator, Storage& storage, std::latch& done)
+{
+	co_await executor.schedule();
+	std::cout << co_await calculator.compute_async(Add{3}) << "\n";
+	std::cout << co_await calculator.compute_async(std::make_unique<StoredAdd>(storage, 7)) << "\n";
+	std::cout << co_await calculator.compute_async(Subtract{4}) << "\n";
+	std::cout << co_await calculator.undo_async() << "\n";
+	// failures in load and in execute reach the awaiting coroutine, the commands after them still run
+	try { co_await calculator.compute_async(std::make_unique<StoredAdd>(storage, storage.size())); }
+	catch(const std::exception& error) { std::cout << "load failed: " << error.what() << "\n"; }
+	try { co_await calculator.compute_async(std::make_unique<Divide>(0)); }
+	catch(const std::exception& error) { std::cout << "execute failed: " << error.what() << "\n"; }
+	std::cout << co_await calculator.compute_async(Add{1}) << "\n";
+	done.count_down();
+}
+
+Detached client(Executor& executor, Calculator& calculator, Storage& storage, std::size_t key, std::latch& done)
+{
+	co_await executor.schedule();
+	co_await calculator.compute_async(std::make_unique<StoredAdd>(storage, key));
+	done.count_down();
+}
+
+template<class Function>
+double elapsed_ms(Function function)
+{
+	const auto start = std::chrono::steady_clock::now();
+	function();
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main()
+{
+	constexpr std::size_t thread_count = 4;
+	constexpr std::size_t commands = 4096;
+	constexpr std::chrono::microseconds latency{500};
+	std::vector<int> values(commands);
+	long long expected = 0;
+	for(std::size_t key = 0; key < commands; ++key) { values[key] = static_cast<int>(key % 10); expected += values[key]; }
+
+	Executor executor{thread_count};
+	Storage storage{executor, latency, values};
+	{
+		Calculator calculator{executor};
+		std::latch done{1};
+		example(executor, calculator, storage, done);
+		done.wait();
+	}
+
+	// every command waits 500 us for storage; blocking threads hide as much latency as there are threads,
+	// coroutines keep all commands in flight on the same threads
+	long long blocking = 0;
+	const double blocking_ms = elapsed_ms([&] {
+		std::mutex mutex;
+		std::vector<std::thread> threads;
+		for(std::size_t t = 0; t < thread_count; ++t)
+		{
+			threads.emplace_back([&, t] {
+				for(std::size_t key = t; key < commands; key += thread_count)
+				{
+					const int operand = storage.read_blocking(key);
+					std::lock_guard lock{mutex};
+					blocking += operand;
+				}
+			});
+		}
+		for(auto& thread : threads) { thread.join(); }
+	});
+
+	Calculator asynchronous{executor};
+	const double asynchronous_ms = elapsed_ms([&] {
+		std::latch done{commands};
+		for(std::size_t key = 0; key < commands; ++key) { client(executor, asynchronous, storage, key, done); }
+		done.wait();
+	});
+	std::cout << commands << " commands, " << latency.count() << " us storage latency, " << thread_count << " threads\n";
+	std::cout << "blocking threads: " << blocking_ms << " ms, result " << blocking << (blocking == expected ? "" : " (wrong)") << "\n";
+	std::cout << "coroutines      : " << asynchronous_ms << " ms, result " << asynchronous.result() << (asynchronous.result() == expected ? "" : " (wrong)") << "\n";
+	return 0;
+}
@@ -0,0 +1,201 @@
+// Reference:
+// Klaus Iglberg.
+// C++ Software Design.
+// Design principles and patterns for high-quality software.
+
+#include <iostream>
+#include <vector>
+#include <variant>
+#include <memory>
+#include <chrono>
+
+// classic interface, kept for user-defined commands
+class CalculatorCommand
+{
+	public:
+	virtual ~CalculatorCommand() = default;
+	virtual int execute(int i) const = 0;
+	virtual int undo(int i) const = 0;
+};
+
+class Add
+{
+	public:
+	explicit Add(int operand) : operand_{operand} {}
+	int execute(int i) const { return i + operand_; }
+	int undo(int i) const { return i - operand_; }
+	int operand() const { return operand_; }
+	private:
+	int operand_;
+};
+
+class Subtract
+{
+	public:
+	explicit Subtract(int operand) : operand_{operand} {}
+	int execute(int i) const { return i - operand_; }
+	int undo(int i) const { return i + operand_; }
+	int operand() const { return operand_; }
+	private:
+	int operand_;
+};
+
+class Shift
+{	// consecutive Add and Subtract commands fused into one, i -> i + delta
+	public:
+	explicit Shift(long long delta) : delta_{delta} {}
+	explicit Shift(const Add& add) : delta_{add.operand()} {}
+	explicit Shift(const Subtract& subtract) : delta_{-static_cast<long long>(subtract.operand())} {}
+	int execute(int i) const { return static_cast<int>(i + delta_); }
+	int undo(int i) const { return static_cast<int>(i - delta_); }
+	void fuse(const Shift& next) { delta_ += next.delta_; count_ += next.count_; }
+	// number of commands fused into this one
+	std::size_t count() const { return count_; }
+	private:
+	long long delta_;
+	std::size_t count_ = 1;
+};
+
+using Command = std::variant<Add, Subtract, std::unique_ptr<CalculatorCommand>>;
+
+class Calculator
+{
+	public:
+	// at most max_fused commands are fused into one, 1 means no fusion
+	explicit Calculator(std::size_t max_fused = 1) : max_fused_{max_fused} {}
+	void compute(Command);
+	// undoes the last history entry, that is all commands fused into it
+	void undo_last();
+	// commands computed after a boundary are never fused with the ones before,
+	// so undo_last goes back exactly to this point
+	void boundary() { open_ = false; }
+	int result() const { return current_; }
+	void clear();
+	// recomputes the result from the history
+	int replay(int initial = 0) const;
+	std::size_t history_size() const { return history_.size(); }
+	std::size_t history_bytes() const { return history_.capacity() * sizeof(Entry); }
+	private:
+	using Entry = std::variant<Shift, std::unique_ptr<CalculatorCommand>>;
+	using CommandHistory = std::vector<Entry>;
+	void push(Shift);
+	std::size_t max_fused_;
+	// whether the last entry may absorb the next command
+	bool open_ = false;
+	int current_ = 0;
+	CommandHistory history_;
+};
+
+struct Execute
+{
+	int current;
+	int operator()(const auto& command) const { return command.execute(current); }
+	int operator()(const std::unique_ptr<CalculatorCommand>& command) const { return command->execute(current); }
+};
+
+struct Undo
+{
+	int current;
+	int operator()(const auto& command) const { return command.undo(current); }
+	int operator()(const std::unique_ptr<CalculatorCommand>& command) const { return command->undo(current); }
+};
+
+void Calculator::push(Shift shift)
+{
+	current_ = shift.execute(current_);
+	if(open_)
+	{
+		auto& last = std::get<Shift>(history_.back());
+		last.fuse(shift);
+		open_ = last.count() < max_fused_;
+		return;
+	}
+	history_.emplace_back(shift);
+	open_ = max_fused_ > 1;
+}
+
+void Calculator::compute(Command command)
+{	// linear commands become shifts, others break the fusion
+	if(const auto* add = std::get_if<Add>(&command)) { push(Shift{*add}); return; }
+	if(const auto* subtract = std::get_if<Subtract>(&command)) { push(Shift{*subtract}); return; }
+	auto& user_command = std::get<std::unique_ptr<CalculatorCommand>>(command);
+	current_ = user_command->execute(current_);
+	history_.emplace_back(std::move(user_command));
+	open_ = false;
+}
+
+void Calculator::undo_last()
+{
+	if(history_.empty() == true) return;
+	current_ = std::visit(Undo{current_}, history_.back());
+	history_.pop_back();
+	open_ = false;
+}
+
+void Calculator::clear()
+{
+	current_ = 0;
+	open_ = false;
+	CommandHistory{}.swap(history_);
+}
+
+int Calculator::replay(int initial) const
+{
+	for(const auto& entry : history_) { initial = std::visit(Execute{initial}, entry); }
+	return initial;
+}
+
+class Multiply : public CalculatorCommand
+{
+	public:
+	explicit Multiply(int operand) : operand_{operand} {}
+	virtual int execute(int i) const override { return i * operand_; }
+	virtual int undo(int i) const override { return i / operand_; }
+	private:
+	int operand_;
+};
+
+template<class Function>
+double elapsed_ms(Function function)
+{
+	const auto start = std::chrono::steady_clock::now();
+	function();
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main()
+{
+	Calculator calculator{16};
+	calculator.compute(Add{3});
+	calculator.compute(Add{7});
+	calculator.compute(std::make_unique<Multiply>(2));
+	calculator.compute(Subtract{4});
+	calculator.boundary();
+	calculator.compute(Subtract{2});
+	calculator.compute(Add{1});
+	calculator.undo_last(); // undoes Subtract{2} and Add{1}
+	std::cout << calculator.result() << " with " << calculator.history_size() << " history entries\n";
+	calculator.undo_last(); // undoes Subtract{4}
+	calculator.undo_last(); // undoes Multiply{2}
+	std::cout << calculator.result() << " with " << calculator.history_size() << " history entries\n";
+
+	// long runs of small adjustments, with a boundary every 1000 commands
+	constexpr int count = 10000000;
+	for(std::size_t max_fused : {1, 16, 1000})
+	{
+		Calculator adjusted{max_fused};
+		const double compute_ms = elapsed_ms([&] {
+			for(int i = 0; i < count; ++i)
+			{
+				if(i % 1000 == 0) adjusted.boundary();
+				if(i % 3 == 0) adjusted.compute(Subtract{1});
+				else adjusted.compute(Add{i % 4});
+			}
+		});
+		int replayed = 0;
+		const double replay_ms = elapsed_ms([&] { replayed = adjusted.replay(); });
+		std::cout << "fusing up to " << max_fused << " commands: " << adjusted.history_size() << " entries, " << adjusted.history_bytes() / 1024 << " KiB history, compute " << compute_ms << " ms, replay " << replay_ms << " ms"
+			<< (replayed == adjusted.result() ? "" : " (replay mismatch)") << "\n";
+	}
+	return 0;
+}
@@ -0,0 +1,476 @@
+// Reference:
+// Klaus Iglberg.
+// C++ Software Design.
+// Design principles and patterns for high-quality software.
+
+// Calculator whose executed commands are written to an append-only binary journal
+// so that its state can be recovered after a restart. POSIX only (open, write, mmap).
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <variant>
+#include <memory>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <typeindex>
+#include <unordered_map>
+#include <filesystem>
+#include <system_error>
+#include <stdexcept>
+#include <chrono>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// classic interface, kept for user-defined commands
+class CalculatorCommand
+{
+	public:
+	virtual ~CalculatorCommand() = default;
+	virtual int execute(int i) const = 0;
+	virtual int undo(int i) const = 0;
+};
+
+class Add
+{
+	public:
+	explicit Add(int operand) : operand_{operand} {}
+	int execute(int i) const { return i + operand_; }
+	int undo(int i) const { return i - operand_; }
+	int operand() const { return operand_; }
+	private:
+	int operand_;
+};
+
+class Subtract
+{
+	public:
+	explicit Subtract(int operand) : operand_{operand} {}
+	int execute(int i) const { return i - operand_; }
+	int undo(int i) const { return i + operand_; }
+	int operand() const { return operand_; }
+	private:
+	int operand_;
+};
+
+using Command = std::variant<Add, Subtract, std::unique_ptr<CalculatorCommand>>;
+
+class CommandCodec
+{	// maps commands to fixed size records and back, user-defined commands have to be registered
+	public:
+	struct Record
+	{	// stored in the byte order of the host
+		std::uint32_t type;
+		std::int32_t operand;
+	};
+	enum : std::uint32_t
+	{
+		undo_type = 0,
+		add_type = 1,
+		subtract_type = 2,
+		first_user_type = 16
+	};
+	using Decoder = std::unique_ptr<CalculatorCommand>(*)(std::int32_t);
+	template<class CommandType>
+	void register_type(std::uint32_t type, std::int32_t (*encode)(const CommandType&), Decoder decode);
+	Record encode(const Command&) const;
+	Command decode(Record) const;
+	// applies the command of a record without constructing it, except for user-defined ones
+	int execute(Record, int) const;
+	int undo(Record, int) const;
+	private:
+	struct Encoder
+	{
+		std::uint32_t type;
+		std::function<std::int32_t(const CalculatorCommand&)> encode;
+	};
+	const Decoder& decoder(std::uint32_t type) const;
+	std::unordered_map<std::type_index, Encoder> encoders_;
+	std::unordered_map<std::uint32_t, Decoder> decoders_;
+};
+
+template<class CommandType>
+void CommandCodec::register_type(std::uint32_t type, std::int32_t (*encode)(const CommandType&), Decoder decode)
+{
+	if(type < first_user_type || decoders_.contains(type)) throw std::invalid_argument("type id is reserved or already registered");
+	encoders_[std::type_index{typeid(CommandType)}] = Encoder{type, [encode](const CalculatorCommand& command) { return encode(static_cast<const CommandType&>(command)); }};
+	decoders_[type] = decode;
+}
+
+CommandCodec::Record CommandCodec::encode(const Command& command) const
+{
+	if(const auto* add = std::get_if<Add>(&command)) return Record{add_type, add->operand()};
+	if(const auto* subtract = std::get_if<Subtract>(&command)) return Record{subtract_type, subtract->operand()};
+	const auto& user_command = *std::get<std::unique_ptr<CalculatorCommand>>(command);
+	const auto position = encoders_.find(std::type_index{typeid(user_command)});
+	if(position == encoders_.end()) throw std::invalid_argument("command type is not registered");
+	return Record{position->second.type, position->second.encode(user_command)};
+}
+
+const CommandCodec::Decoder& CommandCodec::decoder(std::uint32_t type) const
+{
+	const auto position = decoders_.find(type);
+	if(position == decoders_.end()) throw std::runtime_error("journal contains an unknown command type");
+	return position->second;
+}
+
+Command CommandCodec::decode(Record record) const
+{
+	switch(record.type)
+	{
+		case add_type: return Add{record.operand};
+		case subtract_type: return Subtract{record.operand};
+		default: return decoder(record.type)(record.operand);
+	}
+}
+
+int CommandCodec::execute(Record record, int i) const
+{
+	switch(record.type)
+	{
+		case add_type: return i + record.operand;
+		case subtract_type: return i - record.operand;
+		default: return decoder(record.type)(record.operand)->execute(i);
+	}
+}
+
+int CommandCodec::undo(Record record, int i) const
+{
+	switch(record.type)
+	{
+		case add_type: return i - record.operand;
+		case subtract_type: return i + record.operand;
+		default: return decoder(record.type)(record.operand)->undo(i);
+	}
+}
+
+class CommandJournal
+{	// append-only, records are buffered and written in groups (group commit)
+	public:
+	enum class Durability
+	{
+		flush,	// written to the OS, survives a crash of the process
+		sync	// also synced to the device, survives a crash of the machine
+	};
+	explicit CommandJournal(const std::filesystem::path&, const CommandCodec&, std::size_t group_size = 4096, Durability = Durability::sync);
+	CommandJournal(const CommandJournal&) = delete;
+	CommandJournal& operator=(const CommandJournal&) = delete;
+	// commits the pending records
+	~CommandJournal();
+	void append(const Command& command) { append(codec_->encode(command)); }
+	void append_undo() { append(CommandCodec::Record{CommandCodec::undo_type, 0}); }
+	// writes the pending records at once, all or none of them: on failure the file is truncated back
+	// and the group is dropped, the commands of it that were applied before the failing one stay unjournaled
+	void commit();
+	// result of the journal, computed on the mapped file without rebuilding any history
+	static int replay(const std::filesystem::path&, const CommandCodec&);
+	template<class CalculatorType>
+	static void recover(const std::filesystem::path&, const CommandCodec&, CalculatorType&);
+	private:
+	static constexpr char magic_[8] = {'C', 'A', 'L', 'C', 'J', 'R', 'N', '1'};
+	class MappedRecords;
+	void append(CommandCodec::Record record)
+	{
+		buffer_.push_back(record);
+		if(buffer_.size() >= group_size_) { commit(); }
+	}
+	void write_all(const void*, std::size_t);
+	const CommandCodec* codec_;
+	std::size_t group_size_;
+	Durability durability_;
+	int descriptor_;
+	// size of the file up to the last commit
+	off_t committed_size_ = 0;
+	std::vector<CommandCodec::Record> buffer_;
+};
+
+class CommandJournal::MappedRecords
+{	// read-only mapping of a journal, a torn record at the end (crash during a write) is ignored
+	public:
+	explicit MappedRecords(const std::filesystem::path&);
+	MappedRecords(const MappedRecords&) = delete;
+	MappedRecords& operator=(const MappedRecords&) = delete;
+	~MappedRecords() { if(mapping_ != nullptr) munmap(mapping_, mapped_size_); }
+	const CommandCodec::Record* begin() const { return records_; }
+	const CommandCodec::Record* end() const { return records_ + count_; }
+	private:
+	void* mapping_ = nullptr;
+	std::size_t mapped_size_ = 0;
+	const CommandCodec::Record* records_ = nullptr;
+	std::size_t count_ = 0;
+};
+
+CommandJournal::MappedRecords::MappedRecords(const std::filesystem::path& path)
+{
+	const int descriptor = ::open(path.c_str(), O_RDONLY);
+	if(descriptor < 0) throw std::system_error(errno, std::generic_category(), "cannot open journal");
+	struct stat status;
+	if(::fstat(descriptor, &status) != 0)
+	{
+		::close(descriptor);
+		throw std::system_error(errno, std::generic_category(), "cannot stat journal");
+	}
+	mapped_size_ = static_cast<std::size_t>(status.st_size);
+	if(mapped_size_ > 0)
+	{
+		mapping_ = ::mmap(nullptr, mapped_size_, PROT_READ, MAP_PRIVATE | MAP_POPULATE, descriptor, 0);
+	}
+	::close(descriptor);
+	if(mapping_ == MAP_FAILED)
+	{
+		mapping_ = nullptr;
+		throw std::system_error(errno, std::generic_category(), "cannot map journal");
+	}
+	if(mapped_size_ < sizeof(magic_) || std::memcmp(mapping_, magic_, sizeof(magic_)) != 0)
+	{	// the destructor does not run for a constructor that throws
+		if(mapping_ != nullptr) munmap(mapping_, mapped_size_);
+		mapping_ = nullptr;
+		throw std::runtime_error("file is not a calculator journal");
+	}
+	::madvise(mapping_, mapped_size_, MADV_SEQUENTIAL);
+	records_ = reinterpret_cast<const CommandCodec::Record*>(static_cast<const char*>(mapping_) + sizeof(magic_));
+	count_ = (mapped_size_ - sizeof(magic_)) / sizeof(CommandCodec::Record);
+}
+
+CommandJournal::CommandJournal(const std::filesystem::path& path, const CommandCodec& codec, std::size_t group_size, Durability durability)
+	: codec_{&codec}, group_size_{group_size == 0 ? 1 : group_size}, durability_{durability}
+{
+	descriptor_ = ::open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+	if(descriptor_ < 0) throw std::system_error(errno, std::generic_category(), "cannot open journal");
+	struct stat status;
+	if(::fstat(descriptor_, &status) != 0)
+	{
+		::close(descriptor_);
+		throw std::system_error(errno, std::generic_category(), "cannot stat journal");
+	}
+	committed_size_ = status.st_size;
+	if(committed_size_ == 0)
+	{
+		try { write_all(magic_, sizeof(magic_)); }
+		catch(...) { ::close(descriptor_); throw; }
+		committed_size_ = sizeof(magic_);
+	}
+	buffer_.reserve(group_size_);
+}
+
+CommandJournal::~CommandJournal()
+{	// errors cannot be reported from a destructor, call commit before to handle them
+	try { commit(); } catch(...) {}
+	::close(descriptor_);
+}
+
+void CommandJournal::write_all(const void* data, std::size_t size)
+{
+	const char* bytes = static_cast<const char*>(data);
+	while(size > 0)
+	{
+		const ssize_t written = ::write(descriptor_, bytes, size);
+		if(written < 0)
+		{
+			if(errno == EINTR) continue;
+			throw std::system_error(errno, std::generic_category(), "cannot write journal");
+		}
+		bytes += written;
+		size -= static_cast<std::size_t>(written);
+	}
+}
+
+void CommandJournal::commit()
+{
+	if(buffer_.empty()) return;
+	const std::size_t size = buffer_.size() * sizeof(CommandCodec::Record);
+	try
+	{
+		write_all(buffer_.data(), size);
+		if(durability_ == Durability::sync && ::fdatasync(descriptor_) != 0)
+		{
+			throw std::system_error(errno, std::generic_category(), "cannot sync journal");
+		}
+	}
+	catch(...)
+	{	// neither a partial group nor an unsynced one is left in the file, nor retried by a later commit
+		buffer_.clear();
+		if(::ftruncate(descriptor_, committed_size_) != 0) {}	// best effort, the first error is the one reported
+		throw;
+	}
+	committed_size_ += static_cast<off_t>(size);
+	buffer_.clear();
+}
+
+int CommandJournal::replay(const std::filesystem::path& path, const CommandCodec& codec)
+{	// an undo looks backwards for the record it undoes instead of keeping a stack of all executed records
+	// it remembers that record, so later searches jump over the whole undone block at once
+	const MappedRecords records{path};
+	const CommandCodec::Record* const first = records.begin();
+	const std::size_t count = static_cast<std::size_t>(records.end() - first);
+	std::unordered_map<std::size_t, std::size_t> undone_by;
+	int result = 0;
+	for(std::size_t position = 0; position < count; ++position)
+	{	// Add and Subtract are handled inline, which is what almost every record is
+		switch(first[position].type)
+		{
+			case CommandCodec::add_type: result += first[position].operand; break;
+			case CommandCodec::subtract_type: result -= first[position].operand; break;
+			case CommandCodec::undo_type:
+				for(std::size_t target = position; target > 0;)
+				{
+					--target;
+					if(first[target].type == CommandCodec::undo_type) { target = undone_by[target]; continue; }
+					result = codec.undo(first[target], result);
+					undone_by[position] = target;
+					break;
+				}
+				break;
+			default: result = codec.execute(first[position], result); break;
+		}
+	}
+	return result;
+}
+
+template<class CalculatorType>
+void CommandJournal::recover(const std::filesystem::path& path, const CommandCodec& codec, CalculatorType& calculator)
+{	// rebuilds the history as well, calculator should not be journaling into the same file
+	const MappedRecords records{path};
+	calculator.clear();
+	for(const auto& record : records)
+	{
+		if(record.type == CommandCodec::undo_type) { calculator.undo_last(); }
+		else { calculator.compute(codec.decode(record)); }
+	}
+}
+
+class Calculator
+{
+	public:
+	// every executed command is appended to the journal, if there is one
+	explicit Calculator(CommandJournal* journal = nullptr) : journal_{journal} {}
+	void compute(Command);
+	void undo_last();
+	int result() const { return current_; }
+	void clear();
+	void reserve(std::size_t count) { history_.reserve(count); }
+	private:
+	using CommandHistory = std::vector<Command>;
+	CommandJournal* journal_;
+	int current_ = 0;
+	CommandHistory history_;
+};
+
+struct Execute
+{
+	int current;
+	int operator()(const auto& command) const { return command.execute(current); }
+	int operator()(const std::unique_ptr<CalculatorCommand>& command) const { return command->execute(current); }
+};
+
+struct Undo
+{
+	int current;
+	int operator()(const auto& command) const { return command.undo(current); }
+	int operator()(const std::unique_ptr<CalculatorCommand>& command) const { return command->undo(current); }
+};
+
+void Calculator::compute(Command command)
+{	// journaled before anything changes, so that a command that cannot be recorded is not applied either
+	const int result = std::visit(Execute{current_}, command);
+	if(journal_ != nullptr) { journal_->append(command); }
+	current_ = result;
+	history_.push_back(std::move(command));
+}
+
+void Calculator::undo_last()
+{
+	if(history_.empty() == true) return;
+	const int result = std::visit(Undo{current_}, history_.back());
+	if(journal_ != nullptr) { journal_->append_undo(); }
+	current_ = result;
+	history_.pop_back();
+}
+
+void Calculator::clear()
+{	// not journaled, a journal describes a single calculation
+	current_ = 0;
+	CommandHistory{}.swap(history_);
+}
+
+class Multiply : public CalculatorCommand
+{
+	public:
+	explicit Multiply(int operand) : operand_{operand} {}
+	virtual int execute(int i) const override { return i * operand_; }
+	virtual int undo(int i) const override { return i / operand_; }
+	int operand() const { return operand_; }
+	private:
+	int operand_;
+};
+
+template<class Function>
+double elapsed_s(Function function)
+{
+	const auto start = std::chrono::steady_clock::now();
+	function();
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main()
+{
+	CommandCodec codec;
+	codec.register_type<Multiply>(CommandCodec::first_user_type,
+		[](const Multiply& multiply) { return static_cast<std::int32_t>(multiply.operand()); },
+		[](std::int32_t operand) -> std::unique_ptr<CalculatorCommand> { return std::make_unique<Multiply>(operand); });
+
+	const auto path = std::filesystem::temp_directory_path() / "calculator.journal";
+	std::filesystem::remove(path);
+	{
+		CommandJournal journal{path, codec};
+		Calculator calculator{&journal};
+		calculator.compute(Add{3});
+		calculator.compute(Add{7});
+		calculator.compute(std::make_unique<Multiply>(2));
+		calculator.compute(Subtract{4});
+		calculator.compute(Subtract{2});
+		calculator.undo_last();
+		std::cout << calculator.result() << "\n";
+	}
+	// after a restart
+	Calculator recovered{};
+	CommandJournal::recover(path, codec, recovered);
+	std::cout << recovered.result() << " " << CommandJournal::replay(path, codec) << "\n";
+	std::filesystem::remove(path);
+
+	// write throughput for different group sizes, and replay speed
+	constexpr std::size_t count = 10000000;
+	const auto write = [&](std::size_t commands, std::size_t group_size, CommandJournal::Durability durability) {
+		std::filesystem::remove(path);
+		CommandJournal journal{path, codec, group_size, durability};
+		Calculator calculator{&journal};
+		calculator.reserve(commands);
+		const double seconds = elapsed_s([&] {
+			for(std::size_t i = 0; i < commands; ++i)
+			{
+				if(i % 2 == 0) calculator.compute(Add{static_cast<int>(i % 7)});
+				else calculator.compute(Subtract{static_cast<int>(i % 5)});
+			}
+			journal.commit();
+		});
+		std::cout << "write, group of " << group_size << (durability == CommandJournal::Durability::sync ? ", synced  : " : ", flushed : ") << commands / seconds / 1e6 << " M commands/s\n";
+		return calculator.result();
+	};
+	write(10000, 1, CommandJournal::Durability::sync);
+	write(count, 65536, CommandJournal::Durability::sync);
+	const int expected = write(count, 65536, CommandJournal::Durability::flush);
+
+	int replayed = 0;
+	const double replay_s = elapsed_s([&] { replayed = CommandJournal::replay(path, codec); });
+	Calculator rebuilt{};
+	rebuilt.reserve(count);
+	const double recover_s = elapsed_s([&] { CommandJournal::recover(path, codec, rebuilt); });
+	const double gigabytes = static_cast<double>(std::filesystem::file_size(path)) / 1e9;
+	std::cout << "replay (result only)     : " << gigabytes / replay_s << " GB/s" << (replayed == expected ? "" : " (wrong result)") << "\n";
+	std::cout << "recover (with history)   : " << gigabytes / recover_s << " GB/s" << (rebuilt.result() == expected ? "" : " (wrong result)") << "\n";
+	std::filesystem::remove(path);
+	return 0;
+}
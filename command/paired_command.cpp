@@ -0,0 +1,204 @@
+// Reference:
+// Klaus Iglberg.
+// C++ Software Design.
+// Design principles and patterns for high-quality software.
+
+// Functional command with a single capture shared by execute and undo.
+
+#include <iostream>
+#include <stack>
+#include <functional>
+#include <type_traits>
+#include <cstring>
+#include <cstdlib>
+#include <new>
+#include <chrono>
+
+// number of heap allocations, to compare the representations
+static std::size_t allocations = 0;
+
+void* operator new(std::size_t size)
+{
+	++allocations;
+	if(void* pointer = std::malloc(size)) return pointer;
+	throw std::bad_alloc{};
+}
+
+void operator delete(void* pointer) noexcept { std::free(pointer); }
+void operator delete(void* pointer, std::size_t) noexcept { std::free(pointer); }
+
+namespace functional
+{	// same as in functional_command.cpp, used as the baseline
+	struct CalculatorCommand
+	{
+		using function_type = std::function<int(int)>;
+		const function_type execute;
+		const function_type undo;
+	};
+
+	CalculatorCommand make_add(int operand)
+	{
+		struct Execute
+		{
+			const int operand_;
+			int operator()(int i) { return i + operand_; }
+		};
+		struct Undo
+		{
+			const int operand_;
+			int operator()(int i) { return i - operand_; }
+		};
+		CalculatorCommand calc_comm{Execute{operand}, Undo{operand}};
+		return calc_comm;
+	}
+
+	CalculatorCommand make_subtract(int operand)
+	{
+		struct Execute
+		{
+			const int operand_;
+			int operator()(int i) { return i - operand_; }
+		};
+		struct Undo
+		{
+			const int operand_;
+			int operator()(int i) { return i + operand_; }
+		};
+		CalculatorCommand calc_comm{Execute{operand}, Undo{operand}};
+		return calc_comm;
+	}
+}
+
+class CalculatorCommand
+{	// the capture is stored once, inline; execute and undo are two plain function pointers taking it
+	// so a command never allocates and copying it is a memcpy
+	public:
+	static constexpr std::size_t capture_capacity = 16;
+	// Execute and Undo are stateless callables taking (const Capture&, int), captureless lambdas for instance
+	template<class Capture, class Execute, class Undo>
+	CalculatorCommand(Capture capture, Execute, Undo);
+	int execute(int i) const { return execute_(capture_, i); }
+	int undo(int i) const { return undo_(capture_, i); }
+	private:
+	using function_type = int(*)(const void*, int);
+	alignas(void*) unsigned char capture_[capture_capacity];
+	function_type execute_;
+	function_type undo_;
+};
+
+template<class Capture, class Execute, class Undo>
+CalculatorCommand::CalculatorCommand(Capture capture, Execute, Undo)
+{
+	static_assert(std::is_trivially_copyable_v<Capture>, "the capture is copied with memcpy and never destroyed");
+	static_assert(sizeof(Capture) <= capture_capacity && alignof(Capture) <= alignof(void*), "the capture does not fit into the command");
+	static_assert(std::is_empty_v<Execute> && std::is_empty_v<Undo>, "execute and undo must not capture anything themselves");
+	std::memcpy(capture_, &capture, sizeof(Capture));
+	execute_ = [](const void* stored, int i) { return Execute{}(*std::launder(static_cast<const Capture*>(stored)), i); };
+	undo_ = [](const void* stored, int i) { return Undo{}(*std::launder(static_cast<const Capture*>(stored)), i); };
+}
+
+CalculatorCommand make_add(int operand)
+{
+	return CalculatorCommand{operand, [](const int& operand, int i) { return i + operand; }, [](const int& operand, int i) { return i - operand; }};
+}
+
+CalculatorCommand make_subtract(int operand)
+{
+	return CalculatorCommand{operand, [](const int& operand, int i) { return i - operand; }, [](const int& operand, int i) { return i + operand; }};
+}
+
+// new commands only need a capture and a pair of functions
+CalculatorCommand make_affine(int multiplier, int addend)
+{
+	struct Affine { int multiplier; int addend; };
+	return CalculatorCommand{Affine{multiplier, addend},
+		[](const Affine& affine, int i) { return i * affine.multiplier + affine.addend; },
+		[](const Affine& affine, int i) { return (i - affine.addend) / affine.multiplier; }};
+}
+
+template<class Command>
+class Calculator
+{	// same as in functional_command.cpp, for either command representation
+	public:
+	void compute(Command);
+	void undo_last();
+	int result() const { return current_; }
+	void clear();
+	private:
+	using CommandStack = std::stack<Command>;
+	int current_ = 0;
+	CommandStack stack_;
+};
+
+template<class Command>
+void Calculator<Command>::compute(Command command)
+{
+	current_ = command.execute(current_);
+	stack_.push(std::move(command));
+}
+
+template<class Command>
+void Calculator<Command>::undo_last()
+{
+	if(stack_.empty() == true) return;
+	auto command = std::move(stack_.top());
+	stack_.pop();
+	current_ = command.undo(current_);
+}
+
+template<class Command>
+void Calculator<Command>::clear()
+{
+	current_ = 0;
+	CommandStack{}.swap(stack_);
+}
+
+template<class Function>
+double elapsed_ms(Function function)
+{
+	const auto start = std::chrono::steady_clock::now();
+	function();
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+template<class Command, class MakeAdd, class MakeSubtract>
+void benchmark(const char* name, MakeAdd make_add, MakeSubtract make_subtract)
+{	// allocations of the commands alone, then compute and undo 10^7 commands
+	constexpr int count = 10000000;
+	std::size_t before = allocations;
+	{
+		Command add = make_add(3);
+		Command copy = add;
+		if(copy.execute(0) != 3) std::cout << "wrong result\n";
+	}
+	const std::size_t per_command = allocations - before;
+	Calculator<Command> calculator{};
+	before = allocations;
+	const double compute_ms = elapsed_ms([&] {
+		for(int i = 0; i < count; ++i)
+		{
+			if(i % 2 == 0) calculator.compute(make_add(i % 7));
+			else calculator.compute(make_subtract(i % 5));
+		}
+	});
+	const std::size_t history_allocations = allocations - before;
+	const double undo_ms = elapsed_ms([&] { for(int i = 0; i < count; ++i) { calculator.undo_last(); } });
+	std::cout << name << ": sizeof " << sizeof(Command) << ", " << per_command << " allocation(s) to create and copy a command, " << history_allocations << " allocations for 10^7 commands in the history, compute "
+		<< compute_ms << " ms, undo " << undo_ms << " ms, result " << calculator.result() << "\n";
+}
+
+int main()
+{
+	Calculator<CalculatorCommand> calculator{};
+	calculator.compute(make_add(3));
+	calculator.compute(make_add(7));
+	calculator.compute(make_subtract(4));
+	calculator.compute(make_affine(3, 1));
+	calculator.compute(make_subtract(2));
+	calculator.undo_last();
+	std::cout << calculator.result() << "\n";
+
+	benchmark<functional::CalculatorCommand>("two std::function", functional::make_add, functional::make_subtract);
+	benchmark<CalculatorCommand>("shared capture    ", make_add, make_subtract);
+	return 0;
+}
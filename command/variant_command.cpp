@@ -0,0 +1,183 @@
+// Reference:
+// Klaus Iglberg.
+// C++ Software Design.
+// Design principles and patterns for high-quality software.
+
+#include <iostream>
+#include <stack>
+#include <vector>
+#include <variant>
+#include <memory>
+#include <chrono>
+
+// classic interface, kept for user-defined commands
+class CalculatorCommand
+{
+	public:
+	virtual ~CalculatorCommand() = default;
+	virtual int execute(int i) const = 0;
+	virtual int undo(int i) const = 0;
+};
+
+// known commands are plain values, no base class is needed
+class Add
+{
+	public:
+	explicit Add(int operand) : operand_{operand} {}
+	int execute(int i) const { return i + operand_; }
+	int undo(int i) const { return i - operand_; }
+	private:
+	int operand_;
+};
+
+class Subtract
+{
+	public:
+	explicit Subtract(int operand) : operand_{operand} {}
+	int execute(int i) const { return i - operand_; }
+	int undo(int i) const { return i + operand_; }
+	private:
+	int operand_;
+};
+
+// known commands are stored inline, others through the classic interface
+using Command = std::variant<Add, Subtract, std::unique_ptr<CalculatorCommand>>;
+
+class Calculator
+{
+	public:
+	void compute(Command);
+	void undo_last();
+	int result() const { return current_; }
+	void clear();
+	void reserve(std::size_t count) { history_.reserve(count); }
+	private:
+	// contiguous, a command is 16 bytes
+	using CommandHistory = std::vector<Command>;
+	int current_ = 0;
+	CommandHistory history_;
+};
+
+struct Execute
+{
+	int current;
+	int operator()(const auto& command) const { return command.execute(current); }
+	int operator()(const std::unique_ptr<CalculatorCommand>& command) const { return command->execute(current); }
+};
+
+struct Undo
+{
+	int current;
+	int operator()(const auto& command) const { return command.undo(current); }
+	int operator()(const std::unique_ptr<CalculatorCommand>& command) const { return command->undo(current); }
+};
+
+void Calculator::compute(Command command)
+{
+	current_ = std::visit(Execute{current_}, command);
+	history_.push_back(std::move(command));
+}
+
+void Calculator::undo_last()
+{
+	if(history_.empty() == true) return;
+	current_ = std::visit(Undo{current_}, history_.back());
+	history_.pop_back();
+}
+
+void Calculator::clear()
+{
+	current_ = 0;
+	CommandHistory{}.swap(history_);
+}
+
+// user-defined command through the classic interface
+class Multiply : public CalculatorCommand
+{
+	public:
+	explicit Multiply(int operand) : operand_{operand} {}
+	virtual int execute(int i) const override { return i * operand_; }
+	virtual int undo(int i) const override { return i / operand_; }
+	private:
+	int operand_;
+};
+
+template<class CommandType>
+class ClassicModel : public CalculatorCommand
+{	// wraps a known command into the classic interface, used for the benchmark
+	public:
+	explicit ClassicModel(CommandType command) : command_{command} {}
+	virtual int execute(int i) const override { return command_.execute(i); }
+	virtual int undo(int i) const override { return command_.undo(i); }
+	private:
+	CommandType command_;
+};
+
+class ClassicCalculator
+{	// same as in classic_command.cpp, used as the baseline
+	public:
+	using CommandPtrType = std::unique_ptr<CalculatorCommand>;
+	void compute(CommandPtrType command)
+	{
+		current_ = command->execute(current_);
+		stack_.push(std::move(command));
+	}
+	void undo_last()
+	{
+		if(stack_.empty() == true) return;
+		auto command = std::move(stack_.top());
+		stack_.pop();
+		current_ = command->undo(current_);
+	}
+	int result() const { return current_; }
+	private:
+	int current_ = 0;
+	std::stack<CommandPtrType> stack_;
+};
+
+template<class Function>
+double elapsed_ms(Function function)
+{
+	const auto start = std::chrono::steady_clock::now();
+	function();
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main()
+{
+	Calculator calculator{};
+	calculator.compute(Add{3});
+	calculator.compute(Add{7});
+	calculator.compute(std::make_unique<Multiply>(2));
+	calculator.compute(Subtract{4});
+	calculator.compute(Subtract{2});
+	calculator.undo_last();
+	std::cout << calculator.result() << "\n";
+
+	// compute and undo 10^7 commands
+	constexpr int count = 10000000;
+	ClassicCalculator classic{};
+	const double classic_compute_ms = elapsed_ms([&] {
+		for(int i = 0; i < count; ++i)
+		{
+			if(i % 2 == 0) classic.compute(std::make_unique<ClassicModel<Add>>(Add{i % 7}));
+			else classic.compute(std::make_unique<ClassicModel<Subtract>>(Subtract{i % 5}));
+		}
+	});
+	const double classic_undo_ms = elapsed_ms([&] { for(int i = 0; i < count; ++i) { classic.undo_last(); } });
+
+	Calculator contiguous{};
+	contiguous.reserve(count);
+	const double variant_compute_ms = elapsed_ms([&] {
+		for(int i = 0; i < count; ++i)
+		{
+			if(i % 2 == 0) contiguous.compute(Add{i % 7});
+			else contiguous.compute(Subtract{i % 5});
+		}
+	});
+	const double variant_undo_ms = elapsed_ms([&] { for(int i = 0; i < count; ++i) { contiguous.undo_last(); } });
+
+	std::cout << "classic (unique_ptr stack) : compute " << classic_compute_ms << " ms, undo " << classic_undo_ms << " ms, result " << classic.result() << "\n";
+	std::cout << "variant (vector)           : compute " << variant_compute_ms << " ms, undo " << variant_undo_ms << " ms, result " << contiguous.result() << "\n";
+	return 0;
+}
@@ -0,0 +1,1513 @@
+#pragma once
+
+#include <iostream>
+#include <complex>
+#include <vector>
+#include <type_traits>
+#include <algorithm>
+#include <utility>
+#include <thread>
+#include <stdexcept>
+#include <functional>
+#include <memory>
+#include <cstdlib>
+#include <new>
+#include <cmath>
+#ifdef __linux__
+#include <sys/mman.h>
+#endif
+#ifdef __AVX__
+#include <immintrin.h>
+#endif
+
+template<class Type> class PackedStorage;
+template<class Type, template<class> class Storage = PackedStorage> class Matrix;
+
+template<class Type> struct Extract { using value_type = Type; };
+template<class Type, template<class> class Storage> struct Extract<Matrix<Type, Storage>> { using value_type = Type; using storage_type = Storage<Type>; };
+template<class Type> constexpr bool IsMatrix = false;
+template<class Type, template<class> class Storage> constexpr bool IsMatrix<Matrix<Type, Storage>> = true;
+template<class Type> class MatrixSpan;
+template<class Type> using MatrixView = MatrixSpan<const Type>;
+template<class Type> struct Extract<MatrixSpan<Type>> { using value_type = std::remove_const_t<Type>; };
+template<class Derived> class StridedMatrix;
+// matrices and views, whose elements are in memory with a row and a column stride
+template<class Type> constexpr bool IsStrided = std::is_base_of_v<StridedMatrix<Type>, Type>;
+// compressed sparse rows or columns
+enum class SparseLayout { csr, csc };
+template<class Type, SparseLayout Layout = SparseLayout::csr> class SparseMatrix;
+template<class Type, SparseLayout Layout> struct Extract<SparseMatrix<Type, Layout>> { using value_type = Type; };
+template<class Type> constexpr bool IsSparse = false;
+template<class Type, SparseLayout Layout> constexpr bool IsSparse<SparseMatrix<Type, Layout>> = true;
+template<class Type> constexpr bool IsComplex = false;
+template<class Type> constexpr bool IsComplex<std::complex<Type>> = true;
+
+// lazy expressions, see below
+template<class Expression, class Function> class Unary;
+template<class Lhs, class Rhs, class Function> class Binary;
+template<class Expression> class Transposed;
+template<class Expression, class Function> struct Extract<Unary<Expression, Function>> { using value_type = typename Extract<Expression>::value_type; };
+template<class Lhs, class Rhs, class Function> struct Extract<Binary<Lhs, Rhs, Function>> { using value_type = typename Extract<Lhs>::value_type; };
+template<class Expression> struct Extract<Transposed<Expression>> { using value_type = typename Extract<Expression>::value_type; };
+
+// transpose kernels, on raw row-major storage with a row stride
+
+template<class Type>
+struct TransposeKernel
+{	// a square block of size x size elements is transposed at once, one element unless specialized below
+	static constexpr std::size_t size = 1;
+	// destination block = transposed source block
+	static void copy(const Type* source, std::size_t, Type* destination, std::size_t) { *destination = *source; }
+	// destination block = conjugated transposed source block, for complex types
+	static void copy_conj(const Type* source, std::size_t, Type* destination, std::size_t) { *destination = std::conj(*source); }
+	// block a = transposed block b and block b = transposed block a, a and b may be the same block
+	static void swap(Type* a, Type* b, std::size_t) { std::swap(*a, *b); }
+};
+
+#ifdef __AVX__
+template<>
+struct TransposeKernel<double>
+{	// 4 x 4 doubles, transposed in registers
+	static constexpr std::size_t size = 4;
+	static void transpose(__m256d& r0, __m256d& r1, __m256d& r2, __m256d& r3)
+	{
+		const __m256d t0 = _mm256_unpacklo_pd(r0, r1);
+		const __m256d t1 = _mm256_unpackhi_pd(r0, r1);
+		const __m256d t2 = _mm256_unpacklo_pd(r2, r3);
+		const __m256d t3 = _mm256_unpackhi_pd(r2, r3);
+		r0 = _mm256_permute2f128_pd(t0, t2, 0x20);
+		r1 = _mm256_permute2f128_pd(t1, t3, 0x20);
+		r2 = _mm256_permute2f128_pd(t0, t2, 0x31);
+		r3 = _mm256_permute2f128_pd(t1, t3, 0x31);
+	}
+	static void copy(const double* source, std::size_t source_stride, double* destination, std::size_t destination_stride)
+	{
+		__m256d r0 = _mm256_loadu_pd(source);
+		__m256d r1 = _mm256_loadu_pd(source + source_stride);
+		__m256d r2 = _mm256_loadu_pd(source + 2 * source_stride);
+		__m256d r3 = _mm256_loadu_pd(source + 3 * source_stride);
+		transpose(r0, r1, r2, r3);
+		_mm256_storeu_pd(destination, r0);
+		_mm256_storeu_pd(destination + destination_stride, r1);
+		_mm256_storeu_pd(destination + 2 * destination_stride, r2);
+		_mm256_storeu_pd(destination + 3 * destination_stride, r3);
+	}
+	static void swap(double* a, double* b, std::size_t stride)
+	{	// both blocks are loaded before anything is stored
+		__m256d a0 = _mm256_loadu_pd(a), a1 = _mm256_loadu_pd(a + stride), a2 = _mm256_loadu_pd(a + 2 * stride), a3 = _mm256_loadu_pd(a + 3 * stride);
+		__m256d b0 = _mm256_loadu_pd(b), b1 = _mm256_loadu_pd(b + stride), b2 = _mm256_loadu_pd(b + 2 * stride), b3 = _mm256_loadu_pd(b + 3 * stride);
+		transpose(a0, a1, a2, a3);
+		transpose(b0, b1, b2, b3);
+		_mm256_storeu_pd(b, a0); _mm256_storeu_pd(b + stride, a1); _mm256_storeu_pd(b + 2 * stride, a2); _mm256_storeu_pd(b + 3 * stride, a3);
+		_mm256_storeu_pd(a, b0); _mm256_storeu_pd(a + stride, b1); _mm256_storeu_pd(a + 2 * stride, b2); _mm256_storeu_pd(a + 3 * stride, b3);
+	}
+};
+
+template<>
+struct TransposeKernel<std::complex<double>>
+{	// 2 x 2 complex numbers, a register holds a row of two of them
+	static constexpr std::size_t size = 2;
+	static void copy(const std::complex<double>* source, std::size_t source_stride, std::complex<double>* destination, std::size_t destination_stride)
+	{
+		const __m256d r0 = _mm256_loadu_pd(reinterpret_cast<const double*>(source));
+		const __m256d r1 = _mm256_loadu_pd(reinterpret_cast<const double*>(source + source_stride));
+		_mm256_storeu_pd(reinterpret_cast<double*>(destination), _mm256_permute2f128_pd(r0, r1, 0x20));
+		_mm256_storeu_pd(reinterpret_cast<double*>(destination + destination_stride), _mm256_permute2f128_pd(r0, r1, 0x31));
+	}
+	static void copy_conj(const std::complex<double>* source, std::size_t source_stride, std::complex<double>* destination, std::size_t destination_stride)
+	{	// the sign bits of the imaginary parts are flipped on the way
+		const __m256d sign = _mm256_set_pd(-0.0, 0.0, -0.0, 0.0);
+		const __m256d r0 = _mm256_loadu_pd(reinterpret_cast<const double*>(source));
+		const __m256d r1 = _mm256_loadu_pd(reinterpret_cast<const double*>(source + source_stride));
+		_mm256_storeu_pd(reinterpret_cast<double*>(destination), _mm256_xor_pd(_mm256_permute2f128_pd(r0, r1, 0x20), sign));
+		_mm256_storeu_pd(reinterpret_cast<double*>(destination + destination_stride), _mm256_xor_pd(_mm256_permute2f128_pd(r0, r1, 0x31), sign));
+	}
+	static void swap(std::complex<double>* a, std::complex<double>* b, std::size_t stride)
+	{
+		const __m256d a0 = _mm256_loadu_pd(reinterpret_cast<const double*>(a));
+		const __m256d a1 = _mm256_loadu_pd(reinterpret_cast<const double*>(a + stride));
+		const __m256d b0 = _mm256_loadu_pd(reinterpret_cast<const double*>(b));
+		const __m256d b1 = _mm256_loadu_pd(reinterpret_cast<const double*>(b + stride));
+		_mm256_storeu_pd(reinterpret_cast<double*>(b), _mm256_permute2f128_pd(a0, a1, 0x20));
+		_mm256_storeu_pd(reinterpret_cast<double*>(b + stride), _mm256_permute2f128_pd(a0, a1, 0x31));
+		_mm256_storeu_pd(reinterpret_cast<double*>(a), _mm256_permute2f128_pd(b0, b1, 0x20));
+		_mm256_storeu_pd(reinterpret_cast<double*>(a + stride), _mm256_permute2f128_pd(b0, b1, 0x31));
+	}
+};
+#endif
+
+// edge of the square tiles the transposes work on, about 8 KiB per tile
+template<class Type>
+constexpr std::size_t transpose_tile = std::clamp<std::size_t>(256 / sizeof(Type), 8, 64);
+
+template<bool conjugate = false, class Type>
+void transpose_copy(const Type* source, std::size_t source_stride, Type* destination, std::size_t destination_stride, std::size_t rows, std::size_t cols)
+{	// destination (cols x rows) = transposed source (rows x cols), or its Hermitian transpose if conjugate
+	// tile by tile, so that both the rows read and the rows written stay in cache
+	using Kernel = TransposeKernel<Type>;
+	constexpr std::size_t tile = transpose_tile<Type>;
+	const std::size_t full_rows = rows - rows % Kernel::size, full_cols = cols - cols % Kernel::size;
+	for(std::size_t ti = 0; ti < full_rows; ti += tile)
+	{
+		for(std::size_t tj = 0; tj < full_cols; tj += tile)
+		{
+			const std::size_t i_end = std::min(ti + tile, full_rows), j_end = std::min(tj + tile, full_cols);
+			for(std::size_t i = ti; i < i_end; i += Kernel::size)
+			{
+				for(std::size_t j = tj; j < j_end; j += Kernel::size)
+				{
+					if constexpr(conjugate) Kernel::copy_conj(source + i * source_stride + j, source_stride, destination + j * destination_stride + i, destination_stride);
+					else Kernel::copy(source + i * source_stride + j, source_stride, destination + j * destination_stride + i, destination_stride);
+				}
+			}
+		}
+	}
+	// the edges that are not a multiple of the kernel size
+	for(std::size_t i = 0; i < rows; ++i)
+	{
+		for(std::size_t j = (i < full_rows ? full_cols : 0); j < cols; ++j)
+		{
+			if constexpr(conjugate) destination[j * destination_stride + i] = std::conj(source[i * source_stride + j]);
+			else destination[j * destination_stride + i] = source[i * source_stride + j];
+		}
+	}
+}
+
+template<class Type>
+void transpose_square(Type* elements, std::size_t stride, std::size_t n)
+{	// transposes the n x n matrix in place, by swapping tile (I, J) with tile (J, I)
+	using Kernel = TransposeKernel<Type>;
+	constexpr std::size_t tile = transpose_tile<Type>;
+	const std::size_t full = n - n % Kernel::size;
+	for(std::size_t ti = 0; ti < full; ti += tile)
+	{
+		for(std::size_t tj = ti; tj < full; tj += tile)
+		{
+			const std::size_t i_end = std::min(ti + tile, full), j_end = std::min(tj + tile, full);
+			for(std::size_t i = ti; i < i_end; i += Kernel::size)
+			{	// on a diagonal tile, only the blocks on and above the diagonal
+				for(std::size_t j = (ti == tj ? i : tj); j < j_end; j += Kernel::size)
+				{
+					Kernel::swap(elements + i * stride + j, elements + j * stride + i, stride);
+				}
+			}
+		}
+	}
+	for(std::size_t i = 0; i < n; ++i)
+	{
+		for(std::size_t j = std::max(full, i + 1); j < n; ++j) { std::swap(elements[i * stride + j], elements[j * stride + i]); }
+	}
+}
+
+template<class Type>
+void transpose_cycles(Type* elements, std::size_t rows, std::size_t cols)
+{	// transposes the dense rows x cols matrix in place by following the permutation cycles
+	// element k moves to k * rows mod (rows * cols - 1); only one bit per element is allocated, to mark the visited ones
+	const std::size_t last = rows * cols - 1;
+	if(rows < 2 || cols < 2) return;
+	std::vector<bool> visited(rows * cols, false);
+	for(std::size_t start = 1; start < last; ++start)
+	{
+		if(visited[start]) continue;
+		std::size_t position = start;
+		Type moving = std::move(elements[start]);
+		do
+		{
+			const std::size_t next = position * rows % last;
+			std::swap(moving, elements[next]);
+			visited[next] = true;
+			position = next;
+		}
+		while(position != start);
+	}
+}
+
+template<class Type>
+void copy_strided(const Type* source, std::size_t source_row_stride, std::size_t source_col_stride, Type* destination, std::size_t destination_row_stride,
+	std::size_t destination_col_stride, std::size_t rows, std::size_t cols)
+{	// destination = source, both rows x cols with a row and a column stride, through the transpose kernels when exactly one of them is column-major
+	if(source_col_stride == 1 && destination_col_stride == 1)
+	{
+		for(std::size_t i = 0; i < rows; ++i) { std::copy_n(source + i * source_row_stride, cols, destination + i * destination_row_stride); }
+	}
+	else if(source_row_stride == 1 && destination_row_stride == 1)
+	{
+		for(std::size_t j = 0; j < cols; ++j) { std::copy_n(source + j * source_col_stride, rows, destination + j * destination_col_stride); }
+	}
+	else if(source_row_stride == 1 && destination_col_stride == 1) transpose_copy(source, source_col_stride, destination, destination_row_stride, cols, rows);
+	else if(source_col_stride == 1 && destination_row_stride == 1) transpose_copy(source, source_row_stride, destination, destination_col_stride, rows, cols);
+	else
+	{
+		for(std::size_t i = 0; i < rows; ++i)
+		{
+			for(std::size_t j = 0; j < cols; ++j) { destination[i * destination_row_stride + j * destination_col_stride] = source[i * source_row_stride + j * source_col_stride]; }
+		}
+	}
+}
+
+// matrix multiplication kernels, C = alpha * A * B + beta * C on raw row-major storage with row strides
+// C is m x n, A is m x k, B is k x n
+
+template<class Type>
+void multiply_add(Type& sum, const Type& a, const Type& b) { sum += a * b; }
+
+template<class Type>
+void multiply_add(std::complex<Type>& sum, const std::complex<Type>& a, const std::complex<Type>& b)
+{	// without the checks for infinities and NaNs of std::complex multiplication
+	sum = {sum.real() + a.real() * b.real() - a.imag() * b.imag(), sum.imag() + a.real() * b.imag() + a.imag() * b.real()};
+}
+
+template<class Type>
+void gemm_naive(std::size_t m, std::size_t n, std::size_t k, Type alpha, const Type* a, std::size_t lda, const Type* b, std::size_t ldb, Type beta, Type* c, std::size_t ldc)
+{	// reference implementation, for testing the blocked one
+	for(std::size_t i = 0; i < m; ++i)
+	{
+		for(std::size_t j = 0; j < n; ++j)
+		{
+			Type sum = 0;
+			for(std::size_t p = 0; p < k; ++p) { multiply_add(sum, a[i * lda + p], b[p * ldb + j]); }
+			c[i * ldc + j] = beta == Type(0) ? alpha * sum : alpha * sum + beta * c[i * ldc + j];
+		}
+	}
+}
+
+template<class Type>
+void store_tile(const Type* tile, std::size_t tile_stride, std::size_t rows, std::size_t cols, Type alpha, Type beta, Type* c, std::size_t ldc)
+{	// C is not read when beta is zero, so that whatever it holds does not leak into the result
+	for(std::size_t i = 0; i < rows; ++i)
+	{
+		for(std::size_t j = 0; j < cols; ++j)
+		{
+			Type& result = c[i * ldc + j];
+			result = beta == Type(0) ? alpha * tile[i * tile_stride + j] : alpha * tile[i * tile_stride + j] + beta * result;
+		}
+	}
+}
+
+template<class Type>
+struct GemmKernel
+{	// block sizes and micro-kernel, a plain loop unless specialized below
+	// micro-kernel computes an mr x nr tile of C, the blocks of A (mc x kc) and B (kc x nc) are packed to fit into the caches
+	static constexpr std::size_t mr = 4, nr = 4;
+	static constexpr std::size_t mc = 64, kc = 256, nc = 2048;
+	// a: kc x mr packed, b: kc x nr packed; only the first rows x cols results are stored
+	static void micro(std::size_t kc_, Type alpha, const Type* a, const Type* b, Type beta, Type* c, std::size_t ldc, std::size_t rows, std::size_t cols)
+	{
+		Type sum[mr][nr] = {};
+		for(std::size_t p = 0; p < kc_; ++p, a += mr, b += nr)
+		{
+			for(std::size_t i = 0; i < mr; ++i)
+			{
+				for(std::size_t j = 0; j < nr; ++j) { multiply_add(sum[i][j], a[i], b[j]); }
+			}
+		}
+		store_tile(&sum[0][0], nr, rows, cols, alpha, beta, c, ldc);
+	}
+};
+
+#if defined(__AVX2__) && defined(__FMA__)
+template<>
+struct GemmKernel<double>
+{	// 6 x 8 tile of C in 12 AVX registers, one broadcast of A and two loads of B per step
+	static constexpr std::size_t mr = 6, nr = 8;
+	static constexpr std::size_t mc = 72, kc = 256, nc = 2048;
+	static void micro(std::size_t kc_, double alpha, const double* a, const double* b, double beta, double* c, std::size_t ldc, std::size_t rows, std::size_t cols)
+	{
+		__m256d sum[mr][2];
+		#pragma GCC unroll 6
+		for(std::size_t i = 0; i < mr; ++i) { sum[i][0] = _mm256_setzero_pd(); sum[i][1] = _mm256_setzero_pd(); }
+		for(std::size_t p = 0; p < kc_; ++p, a += mr, b += nr)
+		{
+			const __m256d b0 = _mm256_loadu_pd(b), b1 = _mm256_loadu_pd(b + 4);
+			#pragma GCC unroll 6
+			for(std::size_t i = 0; i < mr; ++i)
+			{
+				const __m256d ai = _mm256_broadcast_sd(a + i);
+				sum[i][0] = _mm256_fmadd_pd(ai, b0, sum[i][0]);
+				sum[i][1] = _mm256_fmadd_pd(ai, b1, sum[i][1]);
+			}
+		}
+		if(rows == mr && cols == nr)
+		{
+			const __m256d alpha_ = _mm256_set1_pd(alpha), beta_ = _mm256_set1_pd(beta);
+			#pragma GCC unroll 6
+			for(std::size_t i = 0; i < mr; ++i)
+			{
+				double* row = c + i * ldc;
+				if(beta == 0.0)
+				{
+					_mm256_storeu_pd(row, _mm256_mul_pd(alpha_, sum[i][0]));
+					_mm256_storeu_pd(row + 4, _mm256_mul_pd(alpha_, sum[i][1]));
+				}
+				else
+				{
+					_mm256_storeu_pd(row, _mm256_fmadd_pd(alpha_, sum[i][0], _mm256_mul_pd(beta_, _mm256_loadu_pd(row))));
+					_mm256_storeu_pd(row + 4, _mm256_fmadd_pd(alpha_, sum[i][1], _mm256_mul_pd(beta_, _mm256_loadu_pd(row + 4))));
+				}
+			}
+			return;
+		}
+		// edge tile
+		double tile[mr][nr];
+		for(std::size_t i = 0; i < mr; ++i) { _mm256_storeu_pd(tile[i], sum[i][0]); _mm256_storeu_pd(tile[i] + 4, sum[i][1]); }
+		store_tile(&tile[0][0], nr, rows, cols, alpha, beta, c, ldc);
+	}
+};
+
+template<>
+struct GemmKernel<std::complex<double>>
+{	// 3 x 4 tile of C, a register holds two complex numbers of a row of B
+	// the real and the imaginary part of A are multiplied separately and combined once at the end
+	static constexpr std::size_t mr = 3, nr = 4;
+	static constexpr std::size_t mc = 63, kc = 256, nc = 1024;
+	static void micro(std::size_t kc_, std::complex<double> alpha, const std::complex<double>* a, const std::complex<double>* b, std::complex<double> beta,
+		std::complex<double>* c, std::size_t ldc, std::size_t rows, std::size_t cols)
+	{
+		__m256d real[mr][2], imag[mr][2];
+		#pragma GCC unroll 3
+		for(std::size_t i = 0; i < mr; ++i) { real[i][0] = real[i][1] = imag[i][0] = imag[i][1] = _mm256_setzero_pd(); }
+		for(std::size_t p = 0; p < kc_; ++p, a += mr, b += nr)
+		{
+			const __m256d b0 = _mm256_loadu_pd(reinterpret_cast<const double*>(b)), b1 = _mm256_loadu_pd(reinterpret_cast<const double*>(b + 2));
+			#pragma GCC unroll 3
+			for(std::size_t i = 0; i < mr; ++i)
+			{
+				const __m256d ar = _mm256_broadcast_sd(reinterpret_cast<const double*>(a + i)), ai = _mm256_broadcast_sd(reinterpret_cast<const double*>(a + i) + 1);
+				real[i][0] = _mm256_fmadd_pd(ar, b0, real[i][0]);
+				real[i][1] = _mm256_fmadd_pd(ar, b1, real[i][1]);
+				imag[i][0] = _mm256_fmadd_pd(ai, b0, imag[i][0]);
+				imag[i][1] = _mm256_fmadd_pd(ai, b1, imag[i][1]);
+			}
+		}
+		// (ar br - ai bi, ar bi + ai br)
+		std::complex<double> tile[mr][nr];
+		for(std::size_t i = 0; i < mr; ++i)
+		{
+			_mm256_storeu_pd(reinterpret_cast<double*>(tile[i]), _mm256_addsub_pd(real[i][0], _mm256_permute_pd(imag[i][0], 0b0101)));
+			_mm256_storeu_pd(reinterpret_cast<double*>(tile[i] + 2), _mm256_addsub_pd(real[i][1], _mm256_permute_pd(imag[i][1], 0b0101)));
+		}
+		store_tile(&tile[0][0], nr, rows, cols, alpha, beta, c, ldc);
+	}
+};
+#endif
+
+template<class Type>
+void gemm_blocked(std::size_t m, std::size_t n, std::size_t k, Type alpha, const Type* a, std::size_t rsa, std::size_t csa, const Type* b, std::size_t rsb, std::size_t csb,
+	Type beta, Type* c, std::size_t ldc)
+{	// single threaded: blocks of B and A are packed into panels read contiguously by the micro-kernel,
+	// the B block stays in the last level cache, the A block in L2 and a panel of B in L1
+	// element (i, p) of A is a[i * rsa + p * csa], and likewise for B, so transposed or strided operands are packed as they are
+	using Kernel = GemmKernel<Type>;
+	constexpr std::size_t mr = Kernel::mr, nr = Kernel::nr;
+	if(k == 0)
+	{
+		for(std::size_t i = 0; i < m; ++i) { for(std::size_t j = 0; j < n; ++j) { c[i * ldc + j] = beta == Type(0) ? Type(0) : beta * c[i * ldc + j]; } }
+		return;
+	}
+	std::vector<Type> packed_a(Kernel::mc * Kernel::kc), packed_b(Kernel::kc * ((std::min(n, Kernel::nc) + nr - 1) / nr * nr));
+	for(std::size_t jc = 0; jc < n; jc += Kernel::nc)
+	{
+		const std::size_t nc = std::min(Kernel::nc, n - jc);
+		for(std::size_t pc = 0; pc < k; pc += Kernel::kc)
+		{
+			const std::size_t kc = std::min(Kernel::kc, k - pc);
+			// panels of nr columns, zero padded
+			for(std::size_t jr = 0; jr < nc; jr += nr)
+			{
+				Type* panel = packed_b.data() + jr * kc;
+				for(std::size_t p = 0; p < kc; ++p)
+				{
+					const Type* row = b + (pc + p) * rsb + (jc + jr) * csb;
+					if(csb == 1 && jr + nr <= nc) std::copy_n(row, nr, panel + p * nr);
+					else { for(std::size_t j = 0; j < nr; ++j) { panel[p * nr + j] = jr + j < nc ? row[j * csb] : Type(0); } }
+				}
+			}
+			// the first block of k scales C by beta, the others accumulate into it
+			const Type block_beta = pc == 0 ? beta : Type(1);
+			for(std::size_t ic = 0; ic < m; ic += Kernel::mc)
+			{
+				const std::size_t mc = std::min(Kernel::mc, m - ic);
+				// panels of mr rows, zero padded
+				for(std::size_t ir = 0; ir < mc; ir += mr)
+				{
+					Type* panel = packed_a.data() + ir * kc;
+					for(std::size_t p = 0; p < kc; ++p)
+					{
+						for(std::size_t i = 0; i < mr; ++i) { panel[p * mr + i] = ir + i < mc ? a[(ic + ir + i) * rsa + (pc + p) * csa] : Type(0); }
+					}
+				}
+				for(std::size_t jr = 0; jr < nc; jr += nr)
+				{
+					for(std::size_t ir = 0; ir < mc; ir += mr)
+					{
+						Kernel::micro(kc, alpha, packed_a.data() + ir * kc, packed_b.data() + jr * kc, block_beta, c + (ic + ir) * ldc + jc + jr, ldc,
+							std::min(mr, mc - ir), std::min(nr, nc - jr));
+					}
+				}
+			}
+		}
+	}
+}
+
+template<class Type>
+void gemm_blocked(std::size_t m, std::size_t n, std::size_t k, Type alpha, const Type* a, std::size_t lda, const Type* b, std::size_t ldb, Type beta, Type* c, std::size_t ldc)
+{
+	gemm_blocked(m, n, k, alpha, a, lda, 1, b, ldb, 1, beta, c, ldc);
+}
+
+template<class Type>
+void gemm(std::size_t m, std::size_t n, std::size_t k, Type alpha, const Type* a, std::size_t rsa, std::size_t csa, const Type* b, std::size_t rsb, std::size_t csb,
+	Type beta, Type* c, std::size_t ldc, std::size_t thread_count = std::thread::hardware_concurrency())
+{	// C is split into strips along its longer side, one per thread, each computed by the blocked algorithm
+	using Kernel = GemmKernel<Type>;
+	// small products are not worth a thread
+	constexpr double flops_per_thread = 1 << 22;
+	thread_count = std::clamp<std::size_t>(static_cast<std::size_t>(2.0 * m * n * k / flops_per_thread), 1, std::max<std::size_t>(thread_count, 1));
+	const bool split_rows = m >= n;
+	const std::size_t unit = split_rows ? Kernel::mr : Kernel::nr;
+	const std::size_t length = split_rows ? m : n;
+	// k is not split, so a C narrower than two micro-tiles in both directions is left to a single thread
+	if(thread_count == 1 || length < 2 * unit) { gemm_blocked(m, n, k, alpha, a, rsa, csa, b, rsb, csb, beta, c, ldc); return; }
+	// whole micro-tiles per strip, at least one
+	const std::size_t strip = std::max(unit, ((length + thread_count - 1) / thread_count + unit - 1) / unit * unit);
+	std::vector<std::thread> threads;
+	for(std::size_t begin = 0; begin < length; begin += strip)
+	{
+		const std::size_t size = std::min(strip, length - begin);
+		if(split_rows) threads.emplace_back([=] { gemm_blocked(size, n, k, alpha, a + begin * rsa, rsa, csa, b, rsb, csb, beta, c + begin * ldc, ldc); });
+		else threads.emplace_back([=] { gemm_blocked(m, size, k, alpha, a, rsa, csa, b + begin * csb, rsb, csb, beta, c + begin, ldc); });
+	}
+	for(auto& thread : threads) { thread.join(); }
+}
+
+template<class Type>
+void gemm(std::size_t m, std::size_t n, std::size_t k, Type alpha, const Type* a, std::size_t lda, const Type* b, std::size_t ldb, Type beta, Type* c, std::size_t ldc,
+	std::size_t thread_count = std::thread::hardware_concurrency())
+{
+	gemm(m, n, k, alpha, a, lda, 1, b, ldb, 1, beta, c, ldc, thread_count);
+}
+
+// elementwise complex kernels, on count interleaved (real, imaginary) pairs or on split arrays of real and imaginary parts
+
+template<class Type>
+struct ScalarComplexKernel
+{	// plain loops, without the checks for infinities and NaNs of std::complex multiplication that keep the compiler from vectorizing them
+	using complex_type = std::complex<Type>;
+	static void conj(const complex_type* source, complex_type* destination, std::size_t count)
+	{
+		for(std::size_t i = 0; i < count; ++i) { destination[i] = {source[i].real(), -source[i].imag()}; }
+	}
+	// c = a * b
+	static void multiply(const complex_type* a, const complex_type* b, complex_type* c, std::size_t count)
+	{
+		for(std::size_t i = 0; i < count; ++i) { c[i] = {a[i].real() * b[i].real() - a[i].imag() * b[i].imag(), a[i].real() * b[i].imag() + a[i].imag() * b[i].real()}; }
+	}
+	// c += a * b
+	static void multiply_add(const complex_type* a, const complex_type* b, complex_type* c, std::size_t count)
+	{
+		for(std::size_t i = 0; i < count; ++i) { ::multiply_add(c[i], a[i], b[i]); }
+	}
+	static void norm(const complex_type* source, Type* destination, std::size_t count)
+	{
+		for(std::size_t i = 0; i < count; ++i) { destination[i] = source[i].real() * source[i].real() + source[i].imag() * source[i].imag(); }
+	}
+	// the square root of the norm, which unlike std::abs overflows for magnitudes above the square root of the largest Type
+	static void abs(const complex_type* source, Type* destination, std::size_t count)
+	{
+		for(std::size_t i = 0; i < count; ++i) { destination[i] = std::sqrt(source[i].real() * source[i].real() + source[i].imag() * source[i].imag()); }
+	}
+	// interleaved to split layout and back
+	static void split(const complex_type* source, Type* real, Type* imag, std::size_t count)
+	{
+		for(std::size_t i = 0; i < count; ++i) { real[i] = source[i].real(); imag[i] = source[i].imag(); }
+	}
+	static void interleave(const Type* real, const Type* imag, complex_type* destination, std::size_t count)
+	{
+		for(std::size_t i = 0; i < count; ++i) { destination[i] = {real[i], imag[i]}; }
+	}
+	// c = a * b on split arrays, the compiler vectorizes it as real arithmetic without shuffles
+	static void multiply_split(const Type* a_real, const Type* a_imag, const Type* b_real, const Type* b_imag, Type* c_real, Type* c_imag, std::size_t count)
+	{
+		for(std::size_t i = 0; i < count; ++i)
+		{
+			const Type real = a_real[i] * b_real[i] - a_imag[i] * b_imag[i];
+			const Type imag = a_real[i] * b_imag[i] + a_imag[i] * b_real[i];
+			c_real[i] = real;
+			c_imag[i] = imag;
+		}
+	}
+};
+
+template<class Type>
+struct ComplexKernel : ScalarComplexKernel<Type> {};
+
+#ifdef __AVX__
+template<>
+struct ComplexKernel<double> : ScalarComplexKernel<double>
+{	// two complex numbers per register, the remainder is left to the scalar kernels
+	using Scalar = ScalarComplexKernel<double>;
+	static const double* load(const complex_type* elements) { return reinterpret_cast<const double*>(elements); }
+	static double* store(complex_type* elements) { return reinterpret_cast<double*>(elements); }
+	// (ar, ai) * (br, bi) = (ar br - ai bi, ar bi + ai br): the real parts of a times b, minus and plus the imaginary parts of a times b swapped
+	static __m256d product(__m256d a, __m256d b)
+	{
+		const __m256d real = _mm256_movedup_pd(a), imag = _mm256_permute_pd(a, 0b1111), swapped = _mm256_permute_pd(b, 0b0101);
+		#ifdef __FMA__
+		return _mm256_fmaddsub_pd(real, b, _mm256_mul_pd(imag, swapped));
+		#else
+		return _mm256_addsub_pd(_mm256_mul_pd(real, b), _mm256_mul_pd(imag, swapped));
+		#endif
+	}
+	// four complex numbers as their real parts and their imaginary parts
+	static void split(__m256d first, __m256d second, __m256d& real, __m256d& imag)
+	{
+		const __m256d low = _mm256_permute2f128_pd(first, second, 0x20), high = _mm256_permute2f128_pd(first, second, 0x31);
+		real = _mm256_unpacklo_pd(low, high);
+		imag = _mm256_unpackhi_pd(low, high);
+	}
+	static void conj(const complex_type* source, complex_type* destination, std::size_t count)
+	{
+		const __m256d sign = _mm256_set_pd(-0.0, 0.0, -0.0, 0.0);
+		std::size_t i = 0;
+		for(; i + 2 <= count; i += 2) { _mm256_storeu_pd(store(destination + i), _mm256_xor_pd(_mm256_loadu_pd(load(source + i)), sign)); }
+		Scalar::conj(source + i, destination + i, count - i);
+	}
+	static void multiply(const complex_type* a, const complex_type* b, complex_type* c, std::size_t count)
+	{
+		std::size_t i = 0;
+		for(; i + 2 <= count; i += 2) { _mm256_storeu_pd(store(c + i), product(_mm256_loadu_pd(load(a + i)), _mm256_loadu_pd(load(b + i)))); }
+		Scalar::multiply(a + i, b + i, c + i, count - i);
+	}
+	static void multiply_add(const complex_type* a, const complex_type* b, complex_type* c, std::size_t count)
+	{
+		std::size_t i = 0;
+		for(; i + 2 <= count; i += 2)
+		{
+			_mm256_storeu_pd(store(c + i), _mm256_add_pd(_mm256_loadu_pd(load(c + i)), product(_mm256_loadu_pd(load(a + i)), _mm256_loadu_pd(load(b + i)))));
+		}
+		Scalar::multiply_add(a + i, b + i, c + i, count - i);
+	}
+	static void norm(const complex_type* source, double* destination, std::size_t count)
+	{
+		std::size_t i = 0;
+		for(; i + 4 <= count; i += 4)
+		{
+			__m256d real, imag;
+			split(_mm256_loadu_pd(load(source + i)), _mm256_loadu_pd(load(source + i + 2)), real, imag);
+			_mm256_storeu_pd(destination + i, _mm256_add_pd(_mm256_mul_pd(real, real), _mm256_mul_pd(imag, imag)));
+		}
+		Scalar::norm(source + i, destination + i, count - i);
+	}
+	static void abs(const complex_type* source, double* destination, std::size_t count)
+	{
+		std::size_t i = 0;
+		for(; i + 4 <= count; i += 4)
+		{
+			__m256d real, imag;
+			split(_mm256_loadu_pd(load(source + i)), _mm256_loadu_pd(load(source + i + 2)), real, imag);
+			_mm256_storeu_pd(destination + i, _mm256_sqrt_pd(_mm256_add_pd(_mm256_mul_pd(real, real), _mm256_mul_pd(imag, imag))));
+		}
+		Scalar::abs(source + i, destination + i, count - i);
+	}
+	static void split(const complex_type* source, double* real, double* imag, std::size_t count)
+	{
+		std::size_t i = 0;
+		for(; i + 4 <= count; i += 4)
+		{
+			__m256d real_parts, imag_parts;
+			split(_mm256_loadu_pd(load(source + i)), _mm256_loadu_pd(load(source + i + 2)), real_parts, imag_parts);
+			_mm256_storeu_pd(real + i, real_parts);
+			_mm256_storeu_pd(imag + i, imag_parts);
+		}
+		Scalar::split(source + i, real + i, imag + i, count - i);
+	}
+	static void interleave(const double* real, const double* imag, complex_type* destination, std::size_t count)
+	{
+		std::size_t i = 0;
+		for(; i + 4 <= count; i += 4)
+		{
+			const __m256d real_parts = _mm256_loadu_pd(real + i), imag_parts = _mm256_loadu_pd(imag + i);
+			const __m256d low = _mm256_unpacklo_pd(real_parts, imag_parts), high = _mm256_unpackhi_pd(real_parts, imag_parts);
+			_mm256_storeu_pd(store(destination + i), _mm256_permute2f128_pd(low, high, 0x20));
+			_mm256_storeu_pd(store(destination + i + 2), _mm256_permute2f128_pd(low, high, 0x31));
+		}
+		Scalar::interleave(real + i, imag + i, destination + i, count - i);
+	}
+};
+#endif
+
+// storage policies of the matrices, row-major with a row stride of at least the number of columns
+
+template<class Type>
+class PackedStorage
+{	// rows one after the other without gaps, in a std::vector
+	public:
+	// element i of the matrix is element i of the storage
+	static constexpr bool contiguous = true;
+	PackedStorage(std::size_t row, std::size_t col, const Type& init) : stride_{col}, elements_(row * col, init) {}
+	std::size_t stride() const { return stride_; }
+	Type* data() { return elements_.data(); }
+	const Type* data() const { return elements_.data(); }
+	// the elements are unspecified afterwards
+	void resize(std::size_t row, std::size_t col) { stride_ = col; elements_.resize(row * col); }
+	// same elements, seen as a row x col matrix
+	void reshape(std::size_t, std::size_t col) { stride_ = col; }
+	void swap(PackedStorage& other) { std::swap(stride_, other.stride_); elements_.swap(other.elements_); }
+	private:
+	std::size_t stride_;
+	std::vector<Type> elements_;
+};
+
+template<class Type>
+class AlignedStorage
+{	// every row starts on a cache line, so SIMD loads of a row are aligned and never split across two lines
+	// rows whose size is a multiple of 4 KiB get one more cache line, otherwise the same column of consecutive rows
+	// maps to the same cache set and the tiles of the transpose and GEMM kernels evict each other
+	// large matrices are aligned to 2 MiB and advised as huge pages, which saves TLB misses on strided accesses
+	public:
+	static_assert(std::is_trivially_destructible_v<Type>, "elements are released without calling their destructors");
+	static constexpr bool contiguous = false;
+	static constexpr std::size_t alignment = 64;
+	static constexpr std::size_t huge_page = 2 * 1024 * 1024;
+	AlignedStorage(std::size_t row, std::size_t col, const Type& init) : stride_{padded(row, col)}, count_{row * stride_}, elements_{allocate(count_)}
+	{
+		std::uninitialized_fill_n(elements_.get(), count_, init);
+	}
+	AlignedStorage(const AlignedStorage& other) : stride_{other.stride_}, count_{other.count_}, elements_{allocate(count_)}
+	{
+		std::uninitialized_copy_n(other.elements_.get(), count_, elements_.get());
+	}
+	// a move hands the buffer over and leaves an empty storage behind
+	AlignedStorage(AlignedStorage&& other) noexcept : stride_{std::exchange(other.stride_, 0)}, count_{std::exchange(other.count_, 0)}, elements_{std::move(other.elements_)} {}
+	AlignedStorage& operator=(const AlignedStorage& other)
+	{
+		AlignedStorage copy{other};
+		swap(copy);
+		return *this;
+	}
+	AlignedStorage& operator=(AlignedStorage&& other) noexcept
+	{
+		AlignedStorage moved{std::move(other)};
+		swap(moved);
+		return *this;
+	}
+	std::size_t stride() const { return stride_; }
+	Type* data() { return elements_.get(); }
+	const Type* data() const { return elements_.get(); }
+	void resize(std::size_t row, std::size_t col)
+	{
+		AlignedStorage resized{row, col, Type{}};
+		swap(resized);
+	}
+	void swap(AlignedStorage& other)
+	{
+		std::swap(stride_, other.stride_);
+		std::swap(count_, other.count_);
+		elements_.swap(other.elements_);
+	}
+	private:
+	struct Free { void operator()(Type* elements) const { std::free(elements); } };
+	static std::size_t padded(std::size_t row, std::size_t col)
+	{
+		constexpr std::size_t line = std::max<std::size_t>(alignment / sizeof(Type), 1);
+		std::size_t stride = (col + line - 1) / line * line;
+		if(row > 1 && stride * sizeof(Type) % 4096 == 0) stride += line;
+		return stride;
+	}
+	static Type* allocate(std::size_t count)
+	{
+		const std::size_t bytes = std::max<std::size_t>(count * sizeof(Type), 1);
+		const std::size_t boundary = bytes >= 4 * huge_page ? huge_page : alignment;
+		const std::size_t rounded = (bytes + boundary - 1) / boundary * boundary;
+		void* elements = std::aligned_alloc(boundary, rounded);
+		if(elements == nullptr) throw std::bad_alloc{};
+		#ifdef __linux__
+		// only a hint, transparent huge pages may be disabled
+		if(boundary == huge_page) madvise(elements, rounded, MADV_HUGEPAGE);
+		#endif
+		return static_cast<Type*>(elements);
+	}
+	std::size_t stride_;
+	std::size_t count_;
+	std::unique_ptr<Type[], Free> elements_;
+};
+
+template<class Derived>
+class MatrixExpression
+{	// common base of the matrices and of the lazy expressions combining them
+	// an expression computes nothing until it is assigned to a matrix, then all of it is evaluated in a single pass
+	// every Derived provides row(), col(), operator()(i, j) and refers_to(data), and tells whether it reorders elements
+	public:
+	using value_type = typename Extract<Derived>::value_type;
+	const Derived& derived() const { return static_cast<const Derived&>(*this); }
+	protected:
+	~MatrixExpression() = default;
+};
+
+template<class Derived>
+class StridedMatrix : public MatrixExpression<Derived>
+{	// interface shared by the matrices and the views on their elements
+	// every Derived provides row(), col(), data(), row_stride(), col_stride() and owner(), the start of the memory its elements belong to;
+	// element (i, j) is data()[i * row_stride() + j * col_stride()], so blocks, rows, columns and transposes are views without copies
+	public:
+	using value_type = typename Extract<Derived>::value_type;
+	std::size_t size() const { return matrix(*this).row() * matrix(*this).col(); }
+	// views are mutable when Derived is, and valid as long as its elements are
+	auto view() const { return slice(*this, 0, 0, matrix(*this).row(), matrix(*this).col()); }
+	auto view() { return slice(*this, 0, 0, matrix(*this).row(), matrix(*this).col()); }
+	auto block(std::size_t i, std::size_t j, std::size_t rows, std::size_t cols) const { return slice(*this, i, j, rows, cols); }
+	auto block(std::size_t i, std::size_t j, std::size_t rows, std::size_t cols) { return slice(*this, i, j, rows, cols); }
+	auto row_view(std::size_t i) const { return slice(*this, i, 0, 1, matrix(*this).col()); }
+	auto row_view(std::size_t i) { return slice(*this, i, 0, 1, matrix(*this).col()); }
+	auto col_view(std::size_t j) const { return slice(*this, 0, j, matrix(*this).row(), 1); }
+	auto col_view(std::size_t j) { return slice(*this, 0, j, matrix(*this).row(), 1); }
+	// the strides swapped, except for a temporary matrix, which is transposed into a new one since a view would outlive it
+	auto t() const& { return transposed(*this); }
+	auto t() & { return transposed(*this); }
+	auto t() &&
+	{
+		if constexpr(IsMatrix<Derived>) return Derived(transposed(*this));
+		else return transposed(*this);
+	}
+	void print() const;
+	protected:
+	~StridedMatrix() = default;
+	private:
+	template<class Self>
+	static auto& matrix(Self& self) { return static_cast<std::conditional_t<std::is_const_v<Self>, const Derived, Derived>&>(self); }
+	template<class Self>
+	static auto slice(Self& self, std::size_t i, std::size_t j, std::size_t rows, std::size_t cols)
+	{
+		auto& strided = matrix(self);
+		if(i + rows > strided.row() || j + cols > strided.col()) throw std::out_of_range("block outside of the matrix");
+		using element_type = std::remove_pointer_t<decltype(strided.data())>;
+		return MatrixSpan<element_type>{strided.data() + i * strided.row_stride() + j * strided.col_stride(), rows, cols, strided.row_stride(), strided.col_stride(), strided.owner()};
+	}
+	template<class Self>
+	static auto transposed(Self& self)
+	{
+		auto& strided = matrix(self);
+		using element_type = std::remove_pointer_t<decltype(strided.data())>;
+		return MatrixSpan<element_type>{strided.data(), strided.col(), strided.row(), strided.col_stride(), strided.row_stride(), strided.owner()};
+	}
+};
+
+template<class Derived>
+void StridedMatrix<Derived>::print() const
+{	// should be compared with double loop implementation
+	const Derived& strided = matrix(*this);
+	for(std::size_t i = 0; i < strided.row(); ++i)
+	{
+		for(std::size_t j = 0; j < strided.col(); ++j) { std::cout << strided(i, j) << " "; }
+		std::cout << "\n";
+	}
+}
+
+template<class Type, class Expression>
+void assign_elements(Type* data, std::size_t row_stride, std::size_t col_stride, const Expression& evaluated)
+{	// data = expression, of the same size and not overlapping it
+	// no temporaries, each element of the result is computed at once from the elements of all operands
+	const std::size_t row = evaluated.row(), col = evaluated.col();
+	if constexpr(IsStrided<Expression>)
+	{	// a plain copy
+		copy_strided(evaluated.data(), evaluated.row_stride(), evaluated.col_stride(), data, row_stride, col_stride, row, col);
+	}
+	else if constexpr(IsSparse<Expression>)
+	{	// zeros, then the nonzeros one by one instead of searching each element
+		for(std::size_t i = 0; i < row; ++i)
+		{
+			for(std::size_t j = 0; j < col; ++j) { data[i * row_stride + j * col_stride] = Type(0); }
+		}
+		evaluated.scatter(data, row_stride, col_stride);
+	}
+	else if constexpr(Expression::reorders)
+	{	// tile by tile, as the transposes
+		constexpr std::size_t tile = transpose_tile<Type>;
+		for(std::size_t ti = 0; ti < row; ti += tile)
+		{
+			for(std::size_t tj = 0; tj < col; tj += tile)
+			{
+				for(std::size_t i = ti, i_end = std::min(ti + tile, row); i < i_end; ++i)
+				{
+					for(std::size_t j = tj, j_end = std::min(tj + tile, col); j < j_end; ++j) { data[i * row_stride + j * col_stride] = evaluated(i, j); }
+				}
+			}
+		}
+	}
+	else if(col_stride == 1)
+	{	// row by row, the inner loop is vectorized by the compiler
+		for(std::size_t i = 0; i < row; ++i)
+		{
+			Type* elements = data + i * row_stride;
+			for(std::size_t j = 0; j < col; ++j) { elements[j] = evaluated(i, j); }
+		}
+	}
+	else
+	{
+		for(std::size_t i = 0; i < row; ++i)
+		{
+			for(std::size_t j = 0; j < col; ++j) { data[i * row_stride + j * col_stride] = evaluated(i, j); }
+		}
+	}
+}
+
+// base class
+// class SFINAE = std::enable_if_t<IsMatrix<Derived>, void>
+template<class Derived>
+class MatrixBase : public StridedMatrix<Derived>
+{
+	public:
+	using value_type = typename Extract<Derived>::value_type;
+	using storage_type = typename Extract<Derived>::storage_type;
+	MatrixBase(std::size_t row, std::size_t col, value_type init = 0) : row_{row}, col_{col}, storage_(row, col, init)
+	{	// only deriving classes can instantiate this class because of protected dtor
+		// static_assert(IsMatrix<Derived>, "can only be instantiated with Matrix classes");
+	}
+	// operations defined same for both real and complex matrices, t() and print() are in StridedMatrix
+	// transposes without allocating a second matrix, tiled for square matrices and cycle-following otherwise,
+	// except for rectangular matrices with padded rows, where the stride changes with the shape
+	void transpose_in_place();
+	// access elements
+	value_type& operator()(std::size_t i) { return storage_type::contiguous ? storage_.data()[i] : (*this)(i / col_, i % col_); }
+	const value_type& operator()(std::size_t i) const { return storage_type::contiguous ? storage_.data()[i] : (*this)(i / col_, i % col_); }
+	value_type& operator()(std::size_t i, std::size_t j) { return storage_.data()[i * storage_.stride() + j]; }
+	const value_type& operator()(std::size_t i, std::size_t j) const { return storage_.data()[i * storage_.stride() + j]; }
+	std::size_t row() const { return row_; }
+	std::size_t col() const { return col_; }
+	// row-major elements, row i starts at data() + i * stride(), for the kernels
+	value_type* data() { return storage_.data(); }
+	const value_type* data() const { return storage_.data(); }
+	std::size_t stride() const { return storage_.stride(); }
+	std::size_t row_stride() const { return storage_.stride(); }
+	std::size_t col_stride() const { return 1; }
+	const void* owner() const { return storage_.data(); }
+	// evaluates the expression into this matrix, resized to the size of the expression
+	template<class Expression>
+	Derived& operator=(const MatrixExpression<Expression>&);
+	template<class Expression>
+	Derived& operator+=(const MatrixExpression<Expression>& expression) { return *this = static_cast<const Derived&>(*this) + expression; }
+	template<class Expression>
+	Derived& operator-=(const MatrixExpression<Expression>& expression) { return *this = static_cast<const Derived&>(*this) - expression; }
+	// element (i, j) of a matrix is computed from element (i, j) of its operands only
+	static constexpr bool reorders = false;
+	bool refers_to(const void* data) const { return data != nullptr && data == storage_.data(); }
+	protected:
+	// declared since the dtor below would suppress the moves, which then copied every returned matrix
+	// a moved-from matrix is 0 x 0
+	MatrixBase(const MatrixBase&) = default;
+	MatrixBase(MatrixBase&& other) noexcept : row_{std::exchange(other.row_, 0)}, col_{std::exchange(other.col_, 0)}, storage_{std::move(other.storage_)} {}
+	MatrixBase& operator=(const MatrixBase&) = default;
+	MatrixBase& operator=(MatrixBase&& other) noexcept
+	{
+		storage_ = std::move(other.storage_);
+		row_ = std::exchange(other.row_, 0);
+		col_ = std::exchange(other.col_, 0);
+		return *this;
+	}
+	// base class dtor should be either public virtual or protected nonvirtual
+	~MatrixBase() = default;
+	private:
+	std::size_t row_, col_;
+	storage_type storage_;
+};
+
+
+template<class Derived>
+void MatrixBase<Derived>::transpose_in_place()
+{
+	if(row_ == col_) { transpose_square(data(), stride(), row_); return; }
+	if constexpr(storage_type::contiguous)
+	{
+		transpose_cycles(data(), row_, col_);
+		std::swap(row_, col_);
+		storage_.reshape(row_, col_);
+	}
+	else *this = transpose(static_cast<const Derived&>(*this));
+}
+
+template<class Derived>
+template<class Expression>
+Derived& MatrixBase<Derived>::operator=(const MatrixExpression<Expression>& expression)
+{
+	const Expression& evaluated = expression.derived();
+	if constexpr(Expression::reorders)
+	{	// a transposed operand or a view reads elements after they have been overwritten, so the result goes to a new matrix
+		if(evaluated.refers_to(storage_.data()))
+		{
+			Derived result(evaluated);
+			storage_.swap(result.storage_);
+			row_ = result.row_;
+			col_ = result.col_;
+			return static_cast<Derived&>(*this);
+		}
+	}
+	if(evaluated.row() != row_ || evaluated.col() != col_)
+	{
+		row_ = evaluated.row();
+		col_ = evaluated.col();
+		storage_.resize(row_, col_);
+	}
+	assign_elements(data(), stride(), 1, evaluated);
+	return static_cast<Derived&>(*this);
+}
+
+// c = alpha * a * b + beta * c, c has to have the size of the product
+// any of them may be a matrix or a view, so blocks and transposes are multiplied without copying them
+template<class Lhs, class Rhs, class Result>
+	requires IsStrided<std::remove_cvref_t<Result>>
+void gemm(typename Extract<Lhs>::value_type alpha, const StridedMatrix<Lhs>& lhs, const StridedMatrix<Rhs>& rhs, typename Extract<Lhs>::value_type beta, Result&& c)
+{
+	using value_type = typename Extract<Lhs>::value_type;
+	const Lhs& a = lhs.derived();
+	const Rhs& b = rhs.derived();
+	if(a.col() != b.row() || c.row() != a.row() || c.col() != b.col()) throw std::invalid_argument("matrix sizes do not match for multiplication");
+	if(c.col_stride() == 1)
+	{
+		gemm(a.row(), b.col(), a.col(), alpha, a.data(), a.row_stride(), a.col_stride(), b.data(), b.row_stride(), b.col_stride(), beta, c.data(), c.row_stride());
+	}
+	else if(c.row_stride() == 1)
+	{	// c is column-major, so its transpose b^T * a^T is row-major
+		gemm(b.col(), a.row(), a.col(), alpha, b.data(), b.col_stride(), b.row_stride(), a.data(), a.col_stride(), a.row_stride(), beta, c.data(), c.col_stride());
+	}
+	else
+	{	// the micro-kernels store rows, so c is computed aside
+		Matrix<value_type> product(c.row(), c.col());
+		if(beta != value_type(0)) product = c;
+		gemm(alpha, a, b, beta, product);
+		c = product;
+	}
+}
+
+template<class Derived>
+Derived operator*(const MatrixBase<Derived>& a, const MatrixBase<Derived>& b)
+{
+	Derived product(a.row(), b.col());
+	gemm(typename MatrixBase<Derived>::value_type(1), a, b, typename MatrixBase<Derived>::value_type(0), product);
+	return product;
+}
+
+// real matrix
+template<class Type, template<class> class Storage>
+class Matrix : public MatrixBase<Matrix<Type, Storage>>
+{
+	public:
+	using self_type = Matrix<Type, Storage>;
+	Matrix(std::size_t row, std::size_t col, Type init = 0) : MatrixBase<self_type>{row, col, init} {}
+	template<class Expression>
+	Matrix(const MatrixExpression<Expression>& expression) : MatrixBase<self_type>{0, 0} { *this = expression; }
+	using MatrixBase<self_type>::operator=;
+	// operations not defined for complex matrices
+	// ...
+	private:
+};
+
+// complex matrix
+template<class Type, template<class> class Storage>
+class Matrix<std::complex<Type>, Storage> : public MatrixBase<Matrix<std::complex<Type>, Storage>>
+{
+	public:
+	using self_type = Matrix<std::complex<Type>, Storage>;
+	Matrix(std::size_t row, std::size_t col, std::complex<Type> init = 0) : MatrixBase<self_type>{row, col, init} {}
+	template<class Expression>
+	Matrix(const MatrixExpression<Expression>& expression) : MatrixBase<self_type>{0, 0} { *this = expression; }
+	using MatrixBase<self_type>::operator=;
+	// operations not defined for real matrices
+	self_type conj() const;
+	// Hermitian transpose, conjugated while transposing
+	self_type h() const;
+	Matrix<Type, Storage> abs() const;
+	Matrix<Type, Storage> norm() const;
+	private:
+	// function(source row, destination row, col) for each row, as rows may be padded
+	template<class Result, class Function>
+	Result map_rows(Function function) const;
+};
+
+template<class Type, template<class> class Storage>
+template<class Result, class Function>
+Result Matrix<std::complex<Type>, Storage>::map_rows(Function function) const
+{
+	Result result(this->row(), this->col());
+	for(std::size_t i = 0; i < this->row(); ++i) { function(this->data() + i * this->stride(), result.data() + i * result.stride(), this->col()); }
+	return result;
+}
+
+template<class Type, template<class> class Storage>
+Matrix<std::complex<Type>, Storage> Matrix<std::complex<Type>, Storage>::conj() const
+{
+	return map_rows<self_type>(ComplexKernel<Type>::conj);
+}
+
+template<class Type, template<class> class Storage>
+Matrix<std::complex<Type>, Storage> Matrix<std::complex<Type>, Storage>::h() const
+{
+	self_type transposed(this->col(), this->row());
+	transpose_copy<true>(this->data(), this->stride(), transposed.data(), transposed.stride(), this->row(), this->col());
+	return transposed;
+}
+
+template<class Type, template<class> class Storage>
+Matrix<Type, Storage> Matrix<std::complex<Type>, Storage>::abs() const
+{
+	return map_rows<Matrix<Type, Storage>>(ComplexKernel<Type>::abs);
+}
+
+template<class Type, template<class> class Storage>
+Matrix<Type, Storage> Matrix<std::complex<Type>, Storage>::norm() const
+{
+	return map_rows<Matrix<Type, Storage>>(ComplexKernel<Type>::norm);
+}
+
+// views
+
+template<class Type>
+class MatrixSpan : public StridedMatrix<MatrixSpan<Type>>
+{	// non-owning matrix over strided memory, usually of a Matrix, and a MatrixView when Type is const
+	// copying a span copies the reference, assigning an expression to it writes its elements
+	public:
+	using value_type = std::remove_const_t<Type>;
+	// a view may start anywhere in the memory of a matrix, so element (i, j) of it is not element (i, j) of the matrix
+	static constexpr bool reorders = true;
+	MatrixSpan(Type* data, std::size_t row, std::size_t col, std::size_t row_stride, std::size_t col_stride, const void* owner = nullptr)
+		: data_{data}, row_{row}, col_{col}, row_stride_{row_stride}, col_stride_{col_stride}, owner_{owner == nullptr ? data : owner} {}
+	MatrixSpan(const MatrixSpan&) = default;
+	// a span is a view as well
+	template<class Other>
+		requires std::is_same_v<const Other, Type> && (!std::is_same_v<Other, Type>)
+	MatrixSpan(const MatrixSpan<Other>& other) : MatrixSpan{other.data(), other.row(), other.col(), other.row_stride(), other.col_stride(), other.owner()} {}
+	// writes the elements, the expression has to have the size of the span
+	template<class Expression>
+		requires (!std::is_const_v<Type>)
+	MatrixSpan& operator=(const MatrixExpression<Expression>&);
+	MatrixSpan& operator=(const MatrixSpan& other) requires (!std::is_const_v<Type>) { return *this = static_cast<const MatrixExpression<MatrixSpan>&>(other); }
+	template<class Expression>
+	MatrixSpan& operator+=(const MatrixExpression<Expression>& expression) { return *this = *this + expression; }
+	template<class Expression>
+	MatrixSpan& operator-=(const MatrixExpression<Expression>& expression) { return *this = *this - expression; }
+	// a square span only, the size of the others would change
+	void transpose_in_place() const requires (!std::is_const_v<Type>);
+	// the elements are the ones of the matrix, whatever the constness of the span
+	Type& operator()(std::size_t i) const { return (*this)(i / col_, i % col_); }
+	Type& operator()(std::size_t i, std::size_t j) const { return data_[i * row_stride_ + j * col_stride_]; }
+	std::size_t row() const { return row_; }
+	std::size_t col() const { return col_; }
+	Type* data() const { return data_; }
+	std::size_t row_stride() const { return row_stride_; }
+	std::size_t col_stride() const { return col_stride_; }
+	const void* owner() const { return owner_; }
+	bool refers_to(const void* data) const { return data != nullptr && data == owner_; }
+	private:
+	Type* data_;
+	std::size_t row_, col_;
+	std::size_t row_stride_, col_stride_;
+	const void* owner_;
+};
+
+template<class Type>
+template<class Expression>
+	requires (!std::is_const_v<Type>)
+MatrixSpan<Type>& MatrixSpan<Type>::operator=(const MatrixExpression<Expression>& expression)
+{	// any operand in the same matrix may overlap the span, so the result goes to a new matrix first
+	const Expression& evaluated = expression.derived();
+	if(evaluated.row() != row_ || evaluated.col() != col_) throw std::invalid_argument("matrix sizes do not match for an assignment");
+	if(evaluated.refers_to(owner_))
+	{
+		const Matrix<value_type> result(evaluated);
+		assign_elements(data_, row_stride_, col_stride_, result);
+	}
+	else assign_elements(data_, row_stride_, col_stride_, evaluated);
+	return *this;
+}
+
+template<class Type>
+void MatrixSpan<Type>::transpose_in_place() const requires (!std::is_const_v<Type>)
+{
+	if(row_ != col_) throw std::invalid_argument("only a square view can be transposed in place");
+	if(col_stride_ == 1) transpose_square(data_, row_stride_, row_);
+	else if(row_stride_ == 1) transpose_square(data_, col_stride_, row_);
+	else
+	{
+		for(std::size_t i = 0; i < row_; ++i)
+		{
+			for(std::size_t j = i + 1; j < col_; ++j) { std::swap((*this)(i, j), (*this)(j, i)); }
+		}
+	}
+}
+
+// sparse matrices
+
+template<class Type>
+struct CompressedStorage
+{	// the nonzeros of each major index (row for CSR, column for CSC) in increasing order of their minor index,
+	// those of major index k are at offsets[k] up to offsets[k + 1]
+	std::vector<std::size_t> offsets;
+	std::vector<std::size_t> indices;
+	std::vector<Type> values;
+};
+
+// element (row, col) of a sparse matrix, in whatever layout
+template<class Type>
+struct SparseTriplet
+{
+	std::size_t row, col;
+	Type value;
+};
+
+template<class Type>
+CompressedStorage<Type> transpose_compressed(const CompressedStorage<Type>& source, std::size_t minor_count)
+{	// the same nonzeros compressed along the other index, by a counting sort
+	// walking the source in order of its major index leaves the result sorted by its minor index
+	CompressedStorage<Type> transposed{std::vector<std::size_t>(minor_count + 1, 0), std::vector<std::size_t>(source.values.size()), std::vector<Type>(source.values.size())};
+	for(std::size_t index : source.indices) { ++transposed.offsets[index + 1]; }
+	for(std::size_t k = 0; k < minor_count; ++k) { transposed.offsets[k + 1] += transposed.offsets[k]; }
+	std::vector<std::size_t> next(transposed.offsets.begin(), transposed.offsets.end() - 1);
+	for(std::size_t major = 0; major + 1 < source.offsets.size(); ++major)
+	{
+		for(std::size_t p = source.offsets[major]; p < source.offsets[major + 1]; ++p)
+		{
+			const std::size_t position = next[source.indices[p]]++;
+			transposed.indices[position] = major;
+			transposed.values[position] = source.values[p];
+		}
+	}
+	return transposed;
+}
+
+template<class Type, SparseLayout Layout>
+class SparseMatrix : public MatrixExpression<SparseMatrix<Type, Layout>>
+{	// only the nonzeros are stored, compressed by row (CSR) or by column (CSC)
+	// takes part in expressions, where each element is found by a binary search, and converts to a dense Matrix directly
+	public:
+	using value_type = Type;
+	static constexpr SparseLayout layout = Layout;
+	static constexpr SparseLayout other_layout = Layout == SparseLayout::csr ? SparseLayout::csc : SparseLayout::csr;
+	// element (i, j) is computed from element (i, j) only, and the nonzeros are never in the memory of a dense matrix
+	static constexpr bool reorders = false;
+	using Triplet = SparseTriplet<Type>;
+	// zero matrix
+	SparseMatrix(std::size_t row, std::size_t col) : row_{row}, col_{col}, storage_{std::vector<std::size_t>(major_count() + 1, 0), {}, {}} {}
+	// in any order, duplicates are summed
+	SparseMatrix(std::size_t row, std::size_t col, const std::vector<Triplet>&);
+	// the nonzeros of a dense matrix or of any expression
+	template<class Expression>
+	explicit SparseMatrix(const MatrixExpression<Expression>&);
+	template<SparseLayout Other>
+	explicit SparseMatrix(const SparseMatrix<Type, Other>&);
+	// CSR of a matrix is CSC of its transpose, so nothing is reordered, and a temporary gives its nonzeros away
+	SparseMatrix<Type, other_layout> t() const& { return {col_, row_, CompressedStorage<Type>(storage_)}; }
+	SparseMatrix<Type, other_layout> t() && { return {col_, row_, std::move(storage_)}; }
+	Matrix<Type> to_dense() const { return Matrix<Type>(*this); }
+	void print() const;
+	Type operator()(std::size_t i, std::size_t j) const;
+	std::size_t size() const { return row_ * col_; }
+	std::size_t row() const { return row_; }
+	std::size_t col() const { return col_; }
+	std::size_t nonzeros() const { return storage_.values.size(); }
+	const CompressedStorage<Type>& storage() const { return storage_; }
+	// writes the nonzeros into dense row-major or strided memory, leaving the other elements as they are
+	void scatter(Type* data, std::size_t row_stride, std::size_t col_stride) const;
+	bool refers_to(const void*) const { return false; }
+	private:
+	template<class, SparseLayout> friend class SparseMatrix;
+	SparseMatrix(std::size_t row, std::size_t col, CompressedStorage<Type> storage) : row_{row}, col_{col}, storage_{std::move(storage)} {}
+	std::size_t major_count() const { return Layout == SparseLayout::csr ? row_ : col_; }
+	std::size_t minor_count() const { return Layout == SparseLayout::csr ? col_ : row_; }
+	std::size_t row_;
+	std::size_t col_;
+	CompressedStorage<Type> storage_;
+};
+
+template<class Type, SparseLayout Layout>
+SparseMatrix<Type, Layout>::SparseMatrix(std::size_t row, std::size_t col, const std::vector<Triplet>& triplets) : row_{row}, col_{col}
+{	// compressed along the minor index first, then transposed, which sorts each major index by minor index in linear time
+	CompressedStorage<Type> by_minor{std::vector<std::size_t>(minor_count() + 1, 0), std::vector<std::size_t>(triplets.size()), std::vector<Type>(triplets.size())};
+	for(const Triplet& triplet : triplets)
+	{
+		if(triplet.row >= row_ || triplet.col >= col_) throw std::out_of_range("triplet outside of the matrix");
+		++by_minor.offsets[(Layout == SparseLayout::csr ? triplet.col : triplet.row) + 1];
+	}
+	for(std::size_t k = 0; k < minor_count(); ++k) { by_minor.offsets[k + 1] += by_minor.offsets[k]; }
+	std::vector<std::size_t> next(by_minor.offsets.begin(), by_minor.offsets.end() - 1);
+	for(const Triplet& triplet : triplets)
+	{
+		const auto [major, minor] = Layout == SparseLayout::csr ? std::pair{triplet.row, triplet.col} : std::pair{triplet.col, triplet.row};
+		const std::size_t position = next[minor]++;
+		by_minor.indices[position] = major;
+		by_minor.values[position] = triplet.value;
+	}
+	storage_ = transpose_compressed(by_minor, major_count());
+	// duplicates are now next to each other
+	std::size_t kept = 0;
+	for(std::size_t major = 0, begin = 0; major < major_count(); ++major)
+	{
+		const std::size_t end = storage_.offsets[major + 1];
+		storage_.offsets[major] = kept;
+		for(std::size_t p = begin; p < end; ++p)
+		{
+			if(kept > storage_.offsets[major] && storage_.indices[kept - 1] == storage_.indices[p]) storage_.values[kept - 1] += storage_.values[p];
+			else
+			{
+				storage_.indices[kept] = storage_.indices[p];
+				storage_.values[kept++] = storage_.values[p];
+			}
+		}
+		begin = end;
+	}
+	storage_.offsets[major_count()] = kept;
+	storage_.indices.resize(kept);
+	storage_.values.resize(kept);
+}
+
+template<class Type, SparseLayout Layout>
+template<class Expression>
+SparseMatrix<Type, Layout>::SparseMatrix(const MatrixExpression<Expression>& expression) : SparseMatrix{expression.derived().row(), expression.derived().col()}
+{	// along the major index, so the nonzeros come in order
+	const Expression& evaluated = expression.derived();
+	for(std::size_t major = 0; major < major_count(); ++major)
+	{
+		for(std::size_t minor = 0; minor < minor_count(); ++minor)
+		{
+			const Type value = Layout == SparseLayout::csr ? evaluated(major, minor) : evaluated(minor, major);
+			if(value == Type(0)) continue;
+			storage_.indices.push_back(minor);
+			storage_.values.push_back(value);
+		}
+		storage_.offsets[major + 1] = storage_.values.size();
+	}
+}
+
+template<class Type, SparseLayout Layout>
+template<SparseLayout Other>
+SparseMatrix<Type, Layout>::SparseMatrix(const SparseMatrix<Type, Other>& other)
+	: row_{other.row_}, col_{other.col_}, storage_{Other == Layout ? other.storage_ : transpose_compressed(other.storage_, other.minor_count())} {}
+
+template<class Type, SparseLayout Layout>
+Type SparseMatrix<Type, Layout>::operator()(std::size_t i, std::size_t j) const
+{
+	const auto [major, minor] = Layout == SparseLayout::csr ? std::pair{i, j} : std::pair{j, i};
+	const auto begin = storage_.indices.begin() + storage_.offsets[major], end = storage_.indices.begin() + storage_.offsets[major + 1];
+	const auto found = std::lower_bound(begin, end, minor);
+	return found != end && *found == minor ? storage_.values[found - storage_.indices.begin()] : Type(0);
+}
+
+template<class Type, SparseLayout Layout>
+void SparseMatrix<Type, Layout>::scatter(Type* data, std::size_t row_stride, std::size_t col_stride) const
+{
+	const std::size_t major_stride = Layout == SparseLayout::csr ? row_stride : col_stride, minor_stride = Layout == SparseLayout::csr ? col_stride : row_stride;
+	for(std::size_t major = 0; major < major_count(); ++major)
+	{
+		for(std::size_t p = storage_.offsets[major]; p < storage_.offsets[major + 1]; ++p) { data[major * major_stride + storage_.indices[p] * minor_stride] = storage_.values[p]; }
+	}
+}
+
+template<class Type, SparseLayout Layout>
+void SparseMatrix<Type, Layout>::print() const
+{	// as MatrixBase::print, zeros included
+	for(std::size_t i = 0; i < row_; ++i)
+	{
+		for(std::size_t j = 0; j < col_; ++j) { std::cout << (*this)(i, j) << " "; }
+		std::cout << "\n";
+	}
+}
+
+template<class Type, SparseLayout Layout>
+void spmv(Type alpha, const SparseMatrix<Type, Layout>& a, const Type* x, std::size_t incx, Type beta, Type* y, std::size_t incy,
+	std::size_t thread_count = std::thread::hardware_concurrency())
+{	// y = alpha * A * x + beta * y, y is not read when beta is zero
+	// the major indices are split among the threads so that each gets about the same number of nonzeros
+	// CSR: each thread computes its rows of y; CSC: each thread scatters its columns into a y of its own, summed at the end
+	const CompressedStorage<Type>& storage = a.storage();
+	const std::size_t major_count = storage.offsets.size() - 1;
+	constexpr std::size_t nonzeros_per_thread = 1 << 16;
+	thread_count = std::clamp<std::size_t>(a.nonzeros() / nonzeros_per_thread, 1, std::max<std::size_t>(thread_count, 1));
+	std::vector<std::size_t> bounds(thread_count + 1, major_count);
+	bounds[0] = 0;
+	for(std::size_t t = 1; t < thread_count; ++t)
+	{
+		bounds[t] = std::lower_bound(storage.offsets.begin(), storage.offsets.end(), a.nonzeros() * t / thread_count) - storage.offsets.begin();
+	}
+	const auto store = [=](std::size_t i, Type sum) { y[i * incy] = beta == Type(0) ? alpha * sum : alpha * sum + beta * y[i * incy]; };
+	if constexpr(Layout == SparseLayout::csr)
+	{
+		const auto rows = [&](std::size_t begin, std::size_t end) {
+			for(std::size_t i = begin; i < end; ++i)
+			{
+				Type sum = 0;
+				for(std::size_t p = storage.offsets[i]; p < storage.offsets[i + 1]; ++p) { multiply_add(sum, storage.values[p], x[storage.indices[p] * incx]); }
+				store(i, sum);
+			}
+		};
+		std::vector<std::thread> threads;
+		for(std::size_t t = 1; t < thread_count; ++t) { threads.emplace_back(rows, bounds[t], bounds[t + 1]); }
+		rows(bounds[0], bounds[1]);
+		for(auto& thread : threads) { thread.join(); }
+	}
+	else
+	{
+		std::vector<std::vector<Type>> sums(thread_count, std::vector<Type>(a.row(), Type(0)));
+		const auto columns = [&](std::size_t t) {
+			Type* sum = sums[t].data();
+			for(std::size_t j = bounds[t]; j < bounds[t + 1]; ++j)
+			{
+				const Type xj = x[j * incx];
+				for(std::size_t p = storage.offsets[j]; p < storage.offsets[j + 1]; ++p) { multiply_add(sum[storage.indices[p]], storage.values[p], xj); }
+			}
+		};
+		std::vector<std::thread> threads;
+		for(std::size_t t = 1; t < thread_count; ++t) { threads.emplace_back(columns, t); }
+		columns(0);
+		for(auto& thread : threads) { thread.join(); }
+		for(std::size_t i = 0; i < a.row(); ++i)
+		{
+			Type sum = sums[0][i];
+			for(std::size_t t = 1; t < thread_count; ++t) { sum += sums[t][i]; }
+			store(i, sum);
+		}
+	}
+}
+
+// product with a dense matrix or view, one column of it at a time
+template<class Type, SparseLayout Layout, class Derived>
+Matrix<Type> operator*(const SparseMatrix<Type, Layout>& a, const StridedMatrix<Derived>& dense)
+{
+	const Derived& b = dense.derived();
+	if(a.col() != b.row()) throw std::invalid_argument("matrix sizes do not match for multiplication");
+	Matrix<Type> product(a.row(), b.col());
+	for(std::size_t j = 0; j < b.col(); ++j) { spmv(Type(1), a, b.data() + j * b.col_stride(), b.row_stride(), Type(0), product.data() + j, product.stride()); }
+	return product;
+}
+
+// expression nodes
+
+// operands that own their elements, dense or sparse matrices, are kept by reference, expressions by value
+template<class Expression>
+using Operand = std::conditional_t<IsMatrix<Expression> || IsSparse<Expression>, const Expression&, const Expression>;
+
+template<class Expression, class Function>
+class Unary : public MatrixExpression<Unary<Expression, Function>>
+{	// function applied to each element
+	public:
+	using value_type = typename Extract<Expression>::value_type;
+	static constexpr bool reorders = Expression::reorders;
+	Unary(const Expression& expression, Function function) : expression_{expression}, function_{function} {}
+	std::size_t row() const { return expression_.row(); }
+	std::size_t col() const { return expression_.col(); }
+	value_type operator()(std::size_t i, std::size_t j) const { return function_(expression_(i, j)); }
+	bool refers_to(const void* data) const { return expression_.refers_to(data); }
+	private:
+	Operand<Expression> expression_;
+	Function function_;
+};
+
+template<class Lhs, class Rhs, class Function>
+class Binary : public MatrixExpression<Binary<Lhs, Rhs, Function>>
+{	// function applied to each pair of elements at the same position
+	public:
+	using value_type = typename Extract<Lhs>::value_type;
+	static constexpr bool reorders = Lhs::reorders || Rhs::reorders;
+	Binary(const Lhs& lhs, const Rhs& rhs, Function function) : lhs_{lhs}, rhs_{rhs}, function_{function}
+	{
+		if(lhs.row() != rhs.row() || lhs.col() != rhs.col()) throw std::invalid_argument("matrix sizes do not match for an elementwise operation");
+	}
+	std::size_t row() const { return lhs_.row(); }
+	std::size_t col() const { return lhs_.col(); }
+	value_type operator()(std::size_t i, std::size_t j) const { return function_(lhs_(i, j), rhs_(i, j)); }
+	bool refers_to(const void* data) const { return lhs_.refers_to(data) || rhs_.refers_to(data); }
+	private:
+	Operand<Lhs> lhs_;
+	Operand<Rhs> rhs_;
+	Function function_;
+};
+
+template<class Expression>
+class Transposed : public MatrixExpression<Transposed<Expression>>
+{	// view of the transposed operand, nothing is copied
+	public:
+	using value_type = typename Extract<Expression>::value_type;
+	static constexpr bool reorders = true;
+	explicit Transposed(const Expression& expression) : expression_{expression} {}
+	std::size_t row() const { return expression_.col(); }
+	std::size_t col() const { return expression_.row(); }
+	value_type operator()(std::size_t i, std::size_t j) const { return expression_(j, i); }
+	bool refers_to(const void* data) const { return expression_.refers_to(data); }
+	private:
+	Operand<Expression> expression_;
+};
+
+template<class Type>
+struct Scale
+{
+	Type factor;
+	Type operator()(const Type& value) const { return factor * value; }
+};
+
+struct Multiplies
+{	// the product of std::complex checks for infinities and NaNs, which keeps the loop from being vectorized
+	template<class Type>
+	Type operator()(const Type& a, const Type& b) const
+	{
+		Type product{};
+		multiply_add(product, a, b);
+		return product;
+	}
+};
+
+struct Conjugate
+{
+	template<class Type>
+	Type operator()(const Type& value) const
+	{
+		if constexpr(IsComplex<Type>) return std::conj(value);
+		else return value;
+	}
+};
+
+template<class Lhs, class Rhs>
+Binary<Lhs, Rhs, std::plus<>> operator+(const MatrixExpression<Lhs>& lhs, const MatrixExpression<Rhs>& rhs) { return {lhs.derived(), rhs.derived(), {}}; }
+
+template<class Lhs, class Rhs>
+Binary<Lhs, Rhs, std::minus<>> operator-(const MatrixExpression<Lhs>& lhs, const MatrixExpression<Rhs>& rhs) { return {lhs.derived(), rhs.derived(), {}}; }
+
+// elementwise product, operator* is the matrix product
+template<class Lhs, class Rhs>
+Binary<Lhs, Rhs, Multiplies> hadamard(const MatrixExpression<Lhs>& lhs, const MatrixExpression<Rhs>& rhs) { return {lhs.derived(), rhs.derived(), {}}; }
+
+template<class Expression>
+Unary<Expression, std::negate<>> operator-(const MatrixExpression<Expression>& expression) { return {expression.derived(), {}}; }
+
+template<class Expression>
+Unary<Expression, Scale<typename Extract<Expression>::value_type>> operator*(typename Extract<Expression>::value_type factor, const MatrixExpression<Expression>& expression)
+{
+	return {expression.derived(), {factor}};
+}
+
+template<class Expression>
+Unary<Expression, Scale<typename Extract<Expression>::value_type>> operator*(const MatrixExpression<Expression>& expression, typename Extract<Expression>::value_type factor)
+{
+	return {expression.derived(), {factor}};
+}
+
+// lazy counterparts of the t() and conj() members, which return new matrices
+template<class Expression>
+Transposed<Expression> transpose(const MatrixExpression<Expression>& expression) { return Transposed<Expression>{expression.derived()}; }
+
+template<class Expression>
+Unary<Expression, Conjugate> conj(const MatrixExpression<Expression>& expression) { return {expression.derived(), {}}; }
+
+template<class Expression>
+decltype(auto) evaluate(const Expression& expression)
+{	// a matrix or a view as it is, an expression into a new matrix
+	if constexpr(IsStrided<Expression>) return (expression);
+	else return Matrix<typename Extract<Expression>::value_type>(expression);
+}
+
+template<class Lhs, class Rhs>
+auto operator*(const MatrixExpression<Lhs>& lhs, const MatrixExpression<Rhs>& rhs)
+{	// the matrix product needs its operands in memory, so expressions other than views are evaluated first
+	using value_type = typename Extract<Lhs>::value_type;
+	const auto& a = evaluate(lhs.derived());
+	const auto& b = evaluate(rhs.derived());
+	Matrix<value_type> product(a.row(), b.col());
+	gemm(value_type(1), a, b, value_type(0), product);
+	return product;
+}
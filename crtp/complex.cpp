@@ -0,0 +1,152 @@
+#include "Matrix.h"
+#include <chrono>
+#include <random>
+
+using Complex = std::complex<double>;
+using Kernel = ComplexKernel<double>;
+
+std::vector<Complex> random_complex(std::size_t count, std::mt19937& engine)
+{
+	std::uniform_real_distribution<double> value_of{-1.0, 1.0};
+	std::vector<Complex> values(count);
+	for(auto& value : values) { value = {value_of(engine), value_of(engine)}; }
+	return values;
+}
+
+template<class Type>
+bool close(const Type& a, const Type& b) { return std::abs(a - b) <= 1e-12; }
+
+bool kernels_match(std::size_t count, std::mt19937& engine)
+{	// against std::complex, with every remainder of the vectorized loops
+	const std::vector<Complex> a = random_complex(count, engine), b = random_complex(count, engine);
+	std::vector<Complex> c = random_complex(count, engine), conjugated(count), product(count), sum = c, back(count);
+	std::vector<double> norm(count), abs(count), real(count), imag(count), product_real(count), product_imag(count);
+	Kernel::conj(a.data(), conjugated.data(), count);
+	Kernel::multiply(a.data(), b.data(), product.data(), count);
+	Kernel::multiply_add(a.data(), b.data(), sum.data(), count);
+	Kernel::norm(a.data(), norm.data(), count);
+	Kernel::abs(a.data(), abs.data(), count);
+	Kernel::split(a.data(), real.data(), imag.data(), count);
+	Kernel::interleave(real.data(), imag.data(), back.data(), count);
+	std::vector<double> b_real(count), b_imag(count);
+	Kernel::split(b.data(), b_real.data(), b_imag.data(), count);
+	Kernel::multiply_split(real.data(), imag.data(), b_real.data(), b_imag.data(), product_real.data(), product_imag.data(), count);
+	bool correct = true;
+	for(std::size_t i = 0; i < count; ++i)
+	{
+		correct = correct && conjugated[i] == std::conj(a[i]) && close(product[i], a[i] * b[i]) && close(sum[i], c[i] + a[i] * b[i]) && close(norm[i], std::norm(a[i]))
+			&& close(abs[i], std::abs(a[i])) && real[i] == a[i].real() && imag[i] == a[i].imag() && back[i] == a[i] && close(Complex(product_real[i], product_imag[i]), a[i] * b[i]);
+	}
+	return correct;
+}
+
+template<template<class> class Storage>
+bool hermitian_matches(std::size_t row, std::size_t col, std::mt19937& engine)
+{
+	const std::vector<Complex> values = random_complex(row * col, engine);
+	Matrix<Complex, Storage> matrix(row, col);
+	for(std::size_t i = 0; i < matrix.size(); ++i) { matrix(i) = values[i]; }
+	const Matrix<Complex, Storage> transposed = matrix.h(), conjugated = matrix.conj();
+	const Matrix<double, Storage> abs = matrix.abs();
+	bool correct = transposed.row() == col && transposed.col() == row;
+	for(std::size_t i = 0; i < row; ++i)
+	{
+		for(std::size_t j = 0; j < col; ++j)
+		{
+			correct = correct && transposed(j, i) == std::conj(matrix(i, j)) && conjugated(i, j) == std::conj(matrix(i, j)) && close(abs(i, j), std::abs(matrix(i, j)));
+		}
+	}
+	return correct;
+}
+
+template<class Function>
+double elapsed_s(Function function)
+{
+	const auto start = std::chrono::steady_clock::now();
+	function();
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+template<class Scalar, class Vectorized>
+void benchmark(const char* operation, std::size_t elements, Scalar scalar, Vectorized vectorized)
+{	// in giga complex elements per second
+	const double scalar_s = elapsed_s(scalar), vectorized_s = elapsed_s(vectorized);
+	std::cout << operation << ": std::complex " << elements / scalar_s / 1e9 << ", kernel " << elements / vectorized_s / 1e9 << " G elements/s, " << scalar_s / vectorized_s << "x\n";
+}
+
+int main()
+{
+	std::mt19937 engine{49};
+	bool correct = true;
+	for(std::size_t count = 0; count < 40; ++count) { correct = correct && kernels_match(count, engine); }
+	for(std::size_t row : {1, 2, 3, 17, 64})
+	{
+		for(std::size_t col : {1, 4, 5, 33})
+		{
+			correct = correct && hermitian_matches<PackedStorage>(row, col, engine) && hermitian_matches<AlignedStorage>(row, col, engine);
+		}
+	}
+	std::cout << (correct ? "kernels match std::complex\n" : "kernels differ from std::complex\n");
+
+	// 512 elements, 8 KiB per array, so that the arrays stay in L1 and the arithmetic is measured rather than the memory
+	constexpr std::size_t count = 512, repeats = 160000, elements = count * repeats;
+	const std::vector<Complex> a = random_complex(count, engine), b = random_complex(count, engine);
+	std::vector<Complex> c(count);
+	std::vector<double> real(count);
+	benchmark("conj        ", elements,
+		[&] { for(std::size_t r = 0; r < repeats; ++r) { for(std::size_t i = 0; i < count; ++i) { c[i] = std::conj(a[i]); } } },
+		[&] { for(std::size_t r = 0; r < repeats; ++r) { Kernel::conj(a.data(), c.data(), count); } });
+	benchmark("multiply    ", elements,
+		[&] { for(std::size_t r = 0; r < repeats; ++r) { for(std::size_t i = 0; i < count; ++i) { c[i] = a[i] * b[i]; } } },
+		[&] { for(std::size_t r = 0; r < repeats; ++r) { Kernel::multiply(a.data(), b.data(), c.data(), count); } });
+	benchmark("multiply-add", elements,
+		[&] { for(std::size_t r = 0; r < repeats; ++r) { for(std::size_t i = 0; i < count; ++i) { c[i] += a[i] * b[i]; } } },
+		[&] { for(std::size_t r = 0; r < repeats; ++r) { Kernel::multiply_add(a.data(), b.data(), c.data(), count); } });
+	// the sum is componentwise, std::complex already vectorizes
+	benchmark("add         ", elements,
+		[&] { for(std::size_t r = 0; r < repeats; ++r) { for(std::size_t i = 0; i < count; ++i) { c[i] = a[i] + b[i]; } } },
+		[&] { for(std::size_t r = 0; r < repeats; ++r) { for(std::size_t i = 0; i < count; ++i) { c[i] = a[i] + b[i]; } } });
+	benchmark("norm        ", elements,
+		[&] { for(std::size_t r = 0; r < repeats; ++r) { for(std::size_t i = 0; i < count; ++i) { real[i] = std::norm(a[i]); } } },
+		[&] { for(std::size_t r = 0; r < repeats; ++r) { Kernel::norm(a.data(), real.data(), count); } });
+	benchmark("abs         ", elements,
+		[&] { for(std::size_t r = 0; r < repeats; ++r) { for(std::size_t i = 0; i < count; ++i) { real[i] = std::abs(a[i]); } } },
+		[&] { for(std::size_t r = 0; r < repeats; ++r) { Kernel::abs(a.data(), real.data(), count); } });
+
+	// a chain of products on split arrays needs no shuffles; converting pays off when the data stays split for several operations
+	std::vector<double> a_real(count), a_imag(count), b_real(count), b_imag(count), c_real(count), c_imag(count);
+	Kernel::split(a.data(), a_real.data(), a_imag.data(), count);
+	Kernel::split(b.data(), b_real.data(), b_imag.data(), count);
+	benchmark("multiply, split layout", elements,
+		[&] { for(std::size_t r = 0; r < repeats; ++r) { for(std::size_t i = 0; i < count; ++i) { c[i] = a[i] * b[i]; } } },
+		[&] { for(std::size_t r = 0; r < repeats; ++r) { Kernel::multiply_split(a_real.data(), a_imag.data(), b_real.data(), b_imag.data(), c_real.data(), c_imag.data(), count); } });
+	benchmark("multiply, split with conversions", elements,
+		[&] { for(std::size_t r = 0; r < repeats; ++r) { for(std::size_t i = 0; i < count; ++i) { c[i] = a[i] * b[i]; } } },
+		[&] {
+			for(std::size_t r = 0; r < repeats; ++r)
+			{
+				Kernel::split(a.data(), a_real.data(), a_imag.data(), count);
+				Kernel::split(b.data(), b_real.data(), b_imag.data(), count);
+				Kernel::multiply_split(a_real.data(), a_imag.data(), b_real.data(), b_imag.data(), c_real.data(), c_imag.data(), count);
+				Kernel::interleave(c_real.data(), c_imag.data(), c.data(), count);
+			}
+		});
+
+	// matrices, through the expression templates and the members; conj() and h() return new matrices, so the loops write into new ones as well
+	constexpr std::size_t n = 2048;
+	Matrix<Complex> x(n, n), y(n, n), z(n, n);
+	const std::vector<Complex> values = random_complex(n * n, engine);
+	for(std::size_t i = 0; i < x.size(); ++i) { x(i) = values[i]; y(i) = std::conj(values[i]); }
+	benchmark("hadamard 2048 x 2048", n * n,
+		[&] { for(std::size_t i = 0; i < x.size(); ++i) { z(i) = x(i) * y(i); } },
+		[&] { z = hadamard(x, y); });
+	Complex checksum = 0;
+	benchmark("conj 2048 x 2048", n * n,
+		[&] { Matrix<Complex> result(n, n); for(std::size_t i = 0; i < x.size(); ++i) { result(i) = std::conj(x(i)); } checksum += result(1, 2); },
+		[&] { const Matrix<Complex> result = x.conj(); checksum += result(1, 2); });
+	benchmark("hermitian transpose 2048 x 2048", n * n,
+		[&] { Matrix<Complex> result(n, n); for(std::size_t i = 0; i < n; ++i) { for(std::size_t j = 0; j < n; ++j) { result(j, i) = std::conj(x(i, j)); } } checksum += result(1, 2); },
+		[&] { const Matrix<Complex> result = x.h(); checksum += result(1, 2); });
+	std::cout << "checksum " << std::abs(c[count / 2]) + real[count / 3] + std::abs(z(n / 2, n / 3)) + std::abs(checksum) << "\n";
+	return 0;
+}
@@ -0,0 +1,97 @@
+#include "Matrix.h"
+#include <chrono>
+#include <cstdlib>
+#include <new>
+
+// bytes allocated, to count the temporaries
+static std::size_t allocated_bytes = 0;
+
+void* operator new(std::size_t size)
+{
+	allocated_bytes += size;
+	if(void* pointer = std::malloc(size)) return pointer;
+	throw std::bad_alloc{};
+}
+
+void operator delete(void* pointer) noexcept { std::free(pointer); }
+void operator delete(void* pointer, std::size_t) noexcept { std::free(pointer); }
+
+// eager operations, each returning a new matrix, as operators without expression templates would
+template<class Type>
+Matrix<Type> eager_add(const Matrix<Type>& a, const Matrix<Type>& b)
+{
+	Matrix<Type> result(a.row(), a.col());
+	for(std::size_t i = 0; i < a.size(); ++i) { result(i) = a(i) + b(i); }
+	return result;
+}
+
+template<class Type>
+Matrix<Type> eager_subtract(const Matrix<Type>& a, const Matrix<Type>& b)
+{
+	Matrix<Type> result(a.row(), a.col());
+	for(std::size_t i = 0; i < a.size(); ++i) { result(i) = a(i) - b(i); }
+	return result;
+}
+
+template<class Type>
+Matrix<Type> eager_scale(Type factor, const Matrix<Type>& a)
+{
+	Matrix<Type> result(a.row(), a.col());
+	for(std::size_t i = 0; i < a.size(); ++i) { result(i) = factor * a(i); }
+	return result;
+}
+
+template<class Type>
+Matrix<Type> eager_conj(const Matrix<Type>& a)
+{
+	Matrix<Type> result(a.row(), a.col());
+	for(std::size_t i = 0; i < a.size(); ++i) { result(i) = std::conj(a(i)); }
+	return result;
+}
+
+template<class Function>
+double elapsed_ms(Function function)
+{
+	const auto start = std::chrono::steady_clock::now();
+	function();
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+template<class Eager, class Lazy>
+void benchmark(const char* expression, std::size_t matrix_bytes, std::size_t eager_traffic, std::size_t lazy_traffic, Eager eager, Lazy lazy)
+{	// traffic is counted in matrices read or written: an eager operation reads its operands, zeroes and writes its result,
+	// and the last result is moved into the destination
+	std::size_t before = allocated_bytes;
+	const double eager_ms = elapsed_ms(eager);
+	const std::size_t eager_allocated = allocated_bytes - before;
+	before = allocated_bytes;
+	const double lazy_ms = elapsed_ms(lazy);
+	const std::size_t lazy_allocated = allocated_bytes - before;
+	std::cout << expression << "\n";
+	std::cout << "  eager: " << eager_ms << " ms, " << eager_allocated / matrix_bytes << " matrices allocated, " << eager_traffic << " matrices of memory traffic\n";
+	std::cout << "  fused: " << lazy_ms << " ms, " << lazy_allocated / matrix_bytes << " matrices allocated, " << lazy_traffic << " matrices of memory traffic\n";
+}
+
+int main()
+{
+	constexpr std::size_t n = 2048;
+	Matrix<double> a(n, n, 1.0), b(n, n, 2.0), c(n, n, 3.0), result(n, n);
+	const std::size_t bytes = n * n * sizeof(double);
+	benchmark("result = a + 2.0 * b - c", bytes, 3 + 4 + 4, 3 + 1,
+		[&] { result = eager_subtract(eager_add(a, eager_scale(2.0, b)), c); },
+		[&] { result = a + 2.0 * b - c; });
+	benchmark("result = a + transpose(b)", bytes, 3 + 4, 2 + 1,
+		[&] { result = eager_add(a, Matrix<double>(b.t())); },
+		[&] { result = a + transpose(b); });
+
+	Matrix<std::complex<double>> x(n, n, {1.0, 2.0}), y(n, n, {3.0, -1.0}), complex_result(n, n);
+	benchmark("result = conj(x) - 0.5 * y", 2 * bytes, 3 + 3 + 4, 2 + 1,
+		[&] { complex_result = eager_subtract(eager_conj(x), eager_scale(std::complex<double>(0.5), y)); },
+		[&] { complex_result = conj(x) - std::complex<double>(0.5) * y; });
+
+	// the product is still evaluated on its own, the rest is fused
+	Matrix<double> small_a(256, 256, 1.0), small_b(256, 256, 2.0), small_c(256, 256, 3.0), small_d(256, 256, 4.0);
+	Matrix<double> small_result = small_a + small_b * small_c - small_d;
+	std::cout << "a + b * c - d = " << small_result(0, 0) << "\n";
+	return 0;
+}
@@ -0,0 +1,95 @@
+#include "Matrix.h"
+#include <chrono>
+#include <random>
+#include <cmath>
+#include <array>
+
+template<class Type>
+void fill(Matrix<Type>& matrix, std::mt19937& engine)
+{
+	std::uniform_real_distribution<double> value_of{-1.0, 1.0};
+	for(std::size_t i = 0; i < matrix.size(); ++i)
+	{
+		if constexpr(std::is_same_v<Type, double>) matrix(i) = value_of(engine);
+		else matrix(i) = Type(value_of(engine), value_of(engine));
+	}
+}
+
+template<class Type>
+bool multiplies_correctly(std::size_t m, std::size_t n, std::size_t k, std::mt19937& engine)
+{	// against the naive reference, with alpha and beta, on the default number of threads and on 4 of them
+	Matrix<Type> a(m, k), b(k, n), c(m, n), threaded(m, n), expected(m, n);
+	fill(a, engine);
+	fill(b, engine);
+	fill(c, engine);
+	for(std::size_t i = 0; i < c.size(); ++i) { expected(i) = c(i); threaded(i) = c(i); }
+	const Type alpha = 2, beta = -0.5;
+	gemm_naive(m, n, k, alpha, a.data(), k, b.data(), n, beta, expected.data(), n);
+	gemm(alpha, a, b, beta, c);
+	gemm(m, n, k, alpha, a.data(), k, b.data(), n, beta, threaded.data(), n, 4);
+	const Matrix<Type> product = a * b;
+	Matrix<Type> plain(m, n);
+	gemm_naive(m, n, k, Type(1), a.data(), k, b.data(), n, Type(0), plain.data(), n);
+	for(std::size_t i = 0; i < c.size(); ++i)
+	{
+		if(std::abs(c(i) - expected(i)) > 1e-9 * (k + 1) || std::abs(threaded(i) - expected(i)) > 1e-9 * (k + 1) || std::abs(product(i) - plain(i)) > 1e-9 * (k + 1)) return false;
+	}
+	return true;
+}
+
+template<class Function>
+double elapsed_s(Function function)
+{
+	const auto start = std::chrono::steady_clock::now();
+	function();
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+template<class Type>
+void benchmark(const char* name, std::size_t m, std::size_t n, std::size_t k, bool with_naive, std::mt19937& engine)
+{	// a complex multiply-add is 8 real operations, a real one 2
+	constexpr double flops_per_multiply_add = std::is_same_v<Type, double> ? 2.0 : 8.0;
+	Matrix<Type> a(m, k), b(k, n), c(m, n);
+	fill(a, engine);
+	fill(b, engine);
+	const double flops = flops_per_multiply_add * m * n * k;
+	std::cout << name << " " << m << " x " << k << " * " << k << " x " << n << ":";
+	if(with_naive)
+	{
+		const double naive_s = elapsed_s([&] { gemm_naive(m, n, k, Type(1), a.data(), k, b.data(), n, Type(0), c.data(), n); });
+		std::cout << " naive " << flops / naive_s / 1e9 << " GFLOP/s,";
+	}
+	const double single_s = elapsed_s([&] { gemm(m, n, k, Type(1), a.data(), k, b.data(), n, Type(0), c.data(), n, 1); });
+	const double threaded_s = elapsed_s([&] { gemm(Type(1), a, b, Type(0), c); });
+	std::cout << " blocked " << flops / single_s / 1e9 << " GFLOP/s, " << std::thread::hardware_concurrency() << " thread(s) " << flops / threaded_s / 1e9 << " GFLOP/s\n";
+}
+
+int main()
+{
+	std::mt19937 engine{45};
+	bool correct = true;
+	for(std::size_t m : {1, 5, 6, 13, 100})
+	{
+		for(std::size_t n : {1, 7, 8, 17, 300})
+		{
+			for(std::size_t k : {0, 1, 3, 257})
+			{
+				correct = correct && multiplies_correctly<double>(m, n, k, engine) && multiplies_correctly<std::complex<double>>(m, n, k, engine);
+			}
+		}
+	}
+	// large enough for several threads, with C smaller than a micro-tile or a few micro-tiles across
+	for(auto [m, n, k] : {std::array<std::size_t, 3>{3, 3, 1000000}, {1, 9, 500000}, {13, 2, 200000}, {17, 100, 4000}, {100, 17, 4000}})
+	{
+		correct = correct && multiplies_correctly<double>(m, n, k, engine) && multiplies_correctly<std::complex<double>>(m, n, k, engine);
+	}
+	std::cout << (correct ? "products match the naive ones\n" : "products differ from the naive ones\n");
+
+	for(std::size_t n : {128, 512, 1024, 2048}) { benchmark<double>("double", n, n, n, n <= 1024, engine); }
+	benchmark<double>("double tall-skinny", 100000, 32, 32, true, engine);
+	benchmark<double>("double tall-skinny", 20000, 64, 512, true, engine);
+	benchmark<double>("double short-wide", 64, 20000, 512, true, engine);
+	for(std::size_t n : {128, 512, 1024}) { benchmark<std::complex<double>>("complex<double>", n, n, n, n <= 512, engine); }
+	benchmark<std::complex<double>>("complex<double> tall-skinny", 20000, 64, 256, true, engine);
+	return 0;
+}
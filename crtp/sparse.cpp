@@ -0,0 +1,126 @@
+#include "Matrix.h"
+#include <chrono>
+#include <random>
+#include <cmath>
+
+template<class Type>
+using Triplets = std::vector<SparseTriplet<Type>>;
+
+// count nonzeros at random positions, duplicates included
+Triplets<double> random_triplets(std::size_t row, std::size_t col, std::size_t count, std::mt19937& engine)
+{
+	std::uniform_int_distribution<std::size_t> row_of{0, row - 1}, col_of{0, col - 1};
+	std::uniform_real_distribution<double> value_of{-1.0, 1.0};
+	Triplets<double> triplets(count);
+	for(auto& triplet : triplets) { triplet = {row_of(engine), col_of(engine), value_of(engine)}; }
+	return triplets;
+}
+
+template<class Left, class Right>
+bool same(const Left& left, const Right& right)
+{
+	if(left.row() != right.row() || left.col() != right.col()) return false;
+	for(std::size_t i = 0; i < left.row(); ++i)
+	{
+		for(std::size_t j = 0; j < left.col(); ++j) { if(std::abs(left(i, j) - right(i, j)) > 1e-12) return false; }
+	}
+	return true;
+}
+
+bool agrees_with_dense(std::size_t row, std::size_t col, std::size_t count, std::mt19937& engine)
+{	// the triplets summed into a dense matrix are the reference
+	const Triplets<double> triplets = random_triplets(row, col, count, engine);
+	Matrix<double> dense(row, col);
+	for(const auto& triplet : triplets) { dense(triplet.row, triplet.col) += triplet.value; }
+	const SparseMatrix<double> csr(row, col, triplets);
+	const SparseMatrix<double, SparseLayout::csc> csc(row, col, triplets);
+	const SparseMatrix<double, SparseLayout::csc> converted(csr);
+	const SparseMatrix<double> from_dense(dense);
+	Matrix<double> x(col, 3), expected(row, 3);
+	for(std::size_t i = 0; i < x.size(); ++i) { x(i) = static_cast<double>(i % 7) - 3.0; }
+	gemm(1.0, dense, x, 0.0, expected);
+	// y = 2 A x - y, through one and several threads
+	std::vector<double> y(row, 1.0), y_threaded(row, 1.0), y_csc(row, 1.0);
+	spmv(2.0, csr, x.data(), x.stride(), -1.0, y.data(), 1, 1);
+	spmv(2.0, csr, x.data(), x.stride(), -1.0, y_threaded.data(), 1, 4);
+	spmv(2.0, csc, x.data(), x.stride(), -1.0, y_csc.data(), 1, 4);
+	bool correct = same(csr.to_dense(), dense) && same(csc, dense) && same(converted, dense) && same(from_dense, dense) && same(csr.t(), dense.t())
+		&& same(SparseMatrix<double>(csr).t().t(), dense) && same(csr * x, expected) && same(csc * x.block(0, 1, col, 2), expected.block(0, 1, row, 2))
+		&& same(Matrix<double>(dense + csr), 2.0 * dense) && from_dense.nonzeros() == csr.nonzeros();
+	for(std::size_t i = 0; i < row; ++i)
+	{
+		const double reference = 2.0 * expected(i, 0) - 1.0;
+		correct = correct && std::abs(y[i] - reference) < 1e-12 && std::abs(y_threaded[i] - reference) < 1e-12 && std::abs(y_csc[i] - reference) < 1e-12;
+	}
+	return correct;
+}
+
+template<class Function>
+double elapsed_ms(Function function)
+{
+	const auto start = std::chrono::steady_clock::now();
+	function();
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main()
+{
+	SparseMatrix<double> a(3, 4, {{0, 1, 2.0}, {2, 3, 5.0}, {0, 1, 1.0}, {1, 0, -1.0}});
+	a.print();
+	a.t().print();
+	std::cout << a.nonzeros() << " nonzeros\n";
+
+	std::mt19937 engine{50};
+	bool correct = true;
+	for(std::size_t row : {1, 5, 64, 300})
+	{
+		for(std::size_t col : {1, 7, 200})
+		{
+			for(std::size_t count : {0, 1, 20, 2000}) { correct = correct && agrees_with_dense(row, col, count, engine); }
+		}
+	}
+	std::cout << (correct ? "sparse matrices match the dense ones\n" : "sparse matrices differ from the dense ones\n");
+
+	// 10^4 x 10^4 with 0.5% nonzeros: 6 MB in CSR against 800 MB dense
+	constexpr std::size_t n = 10000, count = n * n / 200, repeats = 10;
+	const Triplets<double> triplets = random_triplets(n, n, count, engine);
+	SparseMatrix<double> csr(0, 0);
+	const double build_ms = elapsed_ms([&] { csr = SparseMatrix<double>(n, n, triplets); });
+	SparseMatrix<double, SparseLayout::csc> csc(0, 0);
+	const double convert_ms = elapsed_ms([&] { csc = SparseMatrix<double, SparseLayout::csc>(csr); });
+	Matrix<double> dense(0, 0);
+	const double to_dense_ms = elapsed_ms([&] { dense = csr.to_dense(); });
+	const std::size_t sparse_bytes = csr.nonzeros() * (sizeof(double) + sizeof(std::size_t)) + (n + 1) * sizeof(std::size_t);
+	std::cout << csr.nonzeros() << " nonzeros: built from triplets in " << build_ms << " ms, converted to CSC in " << convert_ms << " ms, to dense in " << to_dense_ms << " ms\n";
+	std::cout << "memory: sparse " << sparse_bytes / 1e6 << " MB, dense " << dense.size() * sizeof(double) / 1e6 << " MB\n";
+
+	std::vector<double> x(n, 1.0), y(n);
+	const auto report = [&](const char* name, double ms) {
+		std::cout << name << ": " << ms / repeats << " ms per product, " << 2.0 * csr.nonzeros() * repeats / ms / 1e6 << " useful GFLOP/s\n";
+	};
+	report("dense gemm      ", elapsed_ms([&] { for(std::size_t r = 0; r < repeats; ++r) { gemm(n, 1, n, 1.0, dense.data(), dense.stride(), x.data(), 1, 0.0, y.data(), 1); } }));
+	report("dense loop      ", elapsed_ms([&] {
+		for(std::size_t r = 0; r < repeats; ++r)
+		{
+			for(std::size_t i = 0; i < n; ++i)
+			{
+				double sum = 0;
+				for(std::size_t j = 0; j < n; ++j) { sum += dense(i, j) * x[j]; }
+				y[i] = sum;
+			}
+		}
+	}));
+	const std::vector<double> expected = y;
+	const auto check = [&] { for(std::size_t i = 0; i < n; ++i) { correct = correct && std::abs(y[i] - expected[i]) < 1e-9; } };
+	correct = true;
+	report("CSR, 1 thread   ", elapsed_ms([&] { for(std::size_t r = 0; r < repeats; ++r) { spmv(1.0, csr, x.data(), 1, 0.0, y.data(), 1, 1); } }));
+	check();
+	report("CSR, 4 threads  ", elapsed_ms([&] { for(std::size_t r = 0; r < repeats; ++r) { spmv(1.0, csr, x.data(), 1, 0.0, y.data(), 1, 4); } }));
+	check();
+	report("CSC, 1 thread   ", elapsed_ms([&] { for(std::size_t r = 0; r < repeats; ++r) { spmv(1.0, csc, x.data(), 1, 0.0, y.data(), 1, 1); } }));
+	check();
+	report("CSC, 4 threads  ", elapsed_ms([&] { for(std::size_t r = 0; r < repeats; ++r) { spmv(1.0, csc, x.data(), 1, 0.0, y.data(), 1, 4); } }));
+	check();
+	std::cout << std::thread::hardware_concurrency() << " hardware thread(s), " << (correct ? "same" : "different") << " products\n";
+	return 0;
+}
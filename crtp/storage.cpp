@@ -0,0 +1,91 @@
+#include "Matrix.h"
+#include <chrono>
+#include <random>
+#include <cmath>
+
+template<class Type>
+using AlignedMatrix = Matrix<Type, AlignedStorage>;
+
+template<class Matrix>
+void fill(Matrix& matrix, std::mt19937& engine)
+{
+	std::uniform_real_distribution<double> value_of{-1.0, 1.0};
+	for(std::size_t i = 0; i < matrix.row(); ++i)
+	{
+		for(std::size_t j = 0; j < matrix.col(); ++j) { matrix(i, j) = value_of(engine); }
+	}
+}
+
+template<class Left, class Right>
+bool same(const Left& left, const Right& right, double tolerance)
+{
+	if(left.row() != right.row() || left.col() != right.col()) return false;
+	for(std::size_t i = 0; i < left.row(); ++i)
+	{
+		for(std::size_t j = 0; j < left.col(); ++j) { if(std::abs(left(i, j) - right(i, j)) > tolerance) return false; }
+	}
+	return true;
+}
+
+bool agrees_with_packed(std::size_t m, std::size_t n, std::size_t k, std::mt19937& engine)
+{	// the same values in both layouts give the same transposes and products
+	Matrix<double> a(m, k), b(k, n);
+	fill(a, engine);
+	fill(b, engine);
+	AlignedMatrix<double> aligned_a(m, k), aligned_b(k, n);
+	aligned_a = a;
+	aligned_b = b;
+	if(aligned_a.stride() % (AlignedStorage<double>::alignment / sizeof(double)) != 0) return false;
+	AlignedMatrix<double> transposed = aligned_a;
+	transposed.transpose_in_place();
+	const AlignedMatrix<double> product = aligned_a * aligned_b;
+	return same(aligned_a.t(), a.t(), 0.0) && same(transposed, a.t(), 0.0) && same(product, a * b, 1e-12 * (k + 1))
+		&& same(AlignedMatrix<double>(aligned_a + aligned_a), a + a, 0.0);
+}
+
+template<class Function>
+double elapsed_ms(Function function)
+{
+	const auto start = std::chrono::steady_clock::now();
+	function();
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+template<class Matrix>
+void benchmark(const char* name, std::size_t n, std::mt19937& engine)
+{	// best of three, so that page faults of the first run do not count
+	Matrix a(n, n), b(n, n), c(n, n);
+	fill(a, engine);
+	fill(b, engine);
+	double transpose_ms = 1e300, gemm_ms = 1e300;
+	for(int run = 0; run < 3; ++run)
+	{
+		transpose_ms = std::min(transpose_ms, elapsed_ms([&] { a.transpose_in_place(); }));
+		gemm_ms = std::min(gemm_ms, elapsed_ms([&] { gemm(1.0, a, b, 0.0, c); }));
+	}
+	const double bytes = 2.0 * sizeof(double) * n * n;
+	std::cout << name << " " << n << " x " << n << " (stride " << a.stride() << "): in-place transpose " << transpose_ms << " ms, " << bytes / transpose_ms / 1e6 << " GB/s; gemm "
+		<< gemm_ms << " ms, " << 2.0 * n * n * n / gemm_ms / 1e6 << " GFLOP/s\n";
+}
+
+int main()
+{
+	std::mt19937 engine{47};
+	bool correct = true;
+	for(std::size_t m : {1, 3, 8, 17, 64})
+	{
+		for(std::size_t n : {1, 5, 8, 31, 512})
+		{
+			for(std::size_t k : {1, 7, 256}) { correct = correct && agrees_with_packed(m, n, k, engine); }
+		}
+	}
+	std::cout << (correct ? "aligned matrices match the packed ones\n" : "aligned matrices differ from the packed ones\n");
+
+	// rows of 512 or 2048 doubles are a multiple of 4 KiB, the aligned storage pads them by a cache line
+	for(std::size_t n : {500, 512, 1000, 1024, 2048})
+	{
+		benchmark<Matrix<double>>("packed ", n, engine);
+		benchmark<AlignedMatrix<double>>("aligned", n, engine);
+	}
+	return 0;
+}
@@ -0,0 +1,87 @@
+#include "Matrix.h"
+#include <chrono>
+#include <memory>
+
+template<class Type>
+Matrix<Type> naive_t(const Matrix<Type>& matrix)
+{	// same as the former MatrixBase::t()
+	Matrix<Type> transposed(matrix.col(), matrix.row());
+	for(std::size_t i = 0; i < matrix.row(); ++i)
+	{
+		for(std::size_t j = 0; j < matrix.col(); ++j)
+		{
+			transposed(j, i) = matrix(i, j);
+		}
+	}
+	return transposed;
+}
+
+template<class Type>
+void fill(Matrix<Type>& matrix)
+{
+	for(std::size_t i = 0; i < matrix.size(); ++i)
+	{
+		if constexpr(std::is_same_v<Type, double>) matrix(i) = static_cast<double>(i);
+		else matrix(i) = Type(static_cast<double>(i), -static_cast<double>(i));
+	}
+}
+
+template<class Type>
+bool transposes_correctly(std::size_t row, std::size_t col)
+{
+	Matrix<Type> matrix(row, col);
+	fill(matrix);
+	const Matrix<Type> expected = naive_t(matrix);
+	const Matrix<Type> transposed = matrix.t();
+	matrix.transpose_in_place();
+	for(std::size_t i = 0; i < expected.size(); ++i)
+	{
+		if(transposed(i) != expected(i) || matrix(i) != expected(i)) return false;
+	}
+	return transposed.row() == col && matrix.row() == col;
+}
+
+template<class Function>
+double elapsed_ms(Function function)
+{
+	const auto start = std::chrono::steady_clock::now();
+	function();
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+template<class Type>
+void benchmark(const char* name, std::size_t row, std::size_t col, bool out_of_place)
+{	// bandwidth counts one read and one write per element
+	auto matrix = std::make_unique<Matrix<Type>>(row, col);
+	fill(*matrix);
+	const double bytes = 2.0 * sizeof(Type) * row * col;
+	std::cout << name << " " << row << " x " << col << ":";
+	if(out_of_place)
+	{
+		const double naive_ms = elapsed_ms([&] { naive_t(*matrix); });
+		const double tiled_ms = elapsed_ms([&] { Matrix<Type> transposed = matrix->t(); });
+		std::cout << " naive " << naive_ms << " ms (" << bytes / naive_ms / 1e6 << " GB/s), tiled " << tiled_ms << " ms (" << bytes / tiled_ms / 1e6 << " GB/s),";
+	}
+	const double in_place_ms = elapsed_ms([&] { matrix->transpose_in_place(); });
+	std::cout << " in place " << in_place_ms << " ms (" << bytes / in_place_ms / 1e6 << " GB/s)\n";
+}
+
+int main()
+{
+	bool correct = true;
+	for(std::size_t row : {1, 3, 4, 17, 64, 65})
+	{
+		for(std::size_t col : {1, 2, 5, 16, 64, 67})
+		{
+			correct = correct && transposes_correctly<double>(row, col) && transposes_correctly<std::complex<double>>(row, col);
+		}
+	}
+	std::cout << (correct ? "transposes match the naive one\n" : "transposes differ from the naive one\n");
+
+	// 16k x 16k doubles take 2 GiB, so the out-of-place transposes, which need two matrices, stop at 8k
+	for(std::size_t n : {64, 256, 1024, 4096, 8192, 16384}) { benchmark<double>("double", n, n, n <= 8192); }
+	for(std::size_t n : {64, 256, 1024, 4096, 8192}) { benchmark<std::complex<double>>("complex<double>", n, n, n <= 4096); }
+	benchmark<double>("double", 4096, 1024, true);
+	benchmark<double>("double", 1000, 3000, true);
+	return 0;
+}
@@ -0,0 +1,94 @@
+#include "Matrix.h"
+#include <chrono>
+#include <cstdlib>
+#include <new>
+
+// bytes allocated, to show that views copy nothing
+static std::size_t allocated_bytes = 0;
+
+void* operator new(std::size_t size)
+{
+	allocated_bytes += size;
+	if(void* pointer = std::malloc(size)) return pointer;
+	throw std::bad_alloc{};
+}
+
+void operator delete(void* pointer) noexcept { std::free(pointer); }
+void operator delete(void* pointer, std::size_t) noexcept { std::free(pointer); }
+
+// copy of a block, as taking a submatrix had to be done without views
+template<class Type>
+Matrix<Type> copy_block(const Matrix<Type>& matrix, std::size_t i, std::size_t j, std::size_t rows, std::size_t cols)
+{
+	Matrix<Type> block(rows, cols);
+	for(std::size_t r = 0; r < rows; ++r)
+	{
+		for(std::size_t c = 0; c < cols; ++c) { block(r, c) = matrix(i + r, j + c); }
+	}
+	return block;
+}
+
+template<class Function>
+double elapsed_ms(Function function)
+{
+	const auto start = std::chrono::steady_clock::now();
+	function();
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+template<class Copying, class Viewing>
+void benchmark(const char* operation, Copying copying, Viewing viewing)
+{
+	std::size_t before = allocated_bytes;
+	const double copying_ms = elapsed_ms(copying);
+	const std::size_t copying_bytes = allocated_bytes - before;
+	before = allocated_bytes;
+	const double viewing_ms = elapsed_ms(viewing);
+	const std::size_t viewing_bytes = allocated_bytes - before;
+	std::cout << operation << "\n";
+	std::cout << "  copies: " << copying_ms << " ms, " << copying_bytes / 1024 << " KiB allocated\n";
+	std::cout << "  views : " << viewing_ms << " ms, " << viewing_bytes / 1024 << " KiB allocated\n";
+}
+
+int main()
+{
+	Matrix<double> a(3, 4);
+	for(std::size_t i = 0; i < a.size(); ++i) { a(i) = static_cast<double>(i); }
+	a.block(1, 1, 2, 2).print();
+	a.col_view(2).t().print();
+	// writes through the view into a
+	a.row_view(0) = 2.0 * a.row_view(2);
+	a.block(0, 0, 2, 2).transpose_in_place();
+	a.print();
+	(a.t() * a.block(0, 0, 3, 2)).print();
+
+	// the product of 2 x 2 blocks of 1024 x 1024 matrices, block by block, and a transposed product
+	constexpr std::size_t n = 2048, half = n / 2;
+	Matrix<double> x(n, n, 1.0), y(n, n, 2.0), z(n, n);
+	benchmark("z = x * y by blocks",
+		[&] {
+			for(std::size_t i = 0; i < n; i += half)
+			{
+				for(std::size_t j = 0; j < n; j += half)
+				{
+					Matrix<double> sum(half, half);
+					for(std::size_t p = 0; p < n; p += half) { sum += copy_block(x, i, p, half, half) * copy_block(y, p, j, half, half); }
+					for(std::size_t r = 0; r < half; ++r) { for(std::size_t c = 0; c < half; ++c) { z(i + r, j + c) = sum(r, c); } }
+				}
+			}
+		},
+		[&] {
+			for(std::size_t i = 0; i < n; i += half)
+			{
+				for(std::size_t j = 0; j < n; j += half)
+				{
+					for(std::size_t p = 0; p < n; p += half) { gemm(1.0, x.block(i, p, half, half), y.block(p, j, half, half), p == 0 ? 0.0 : 1.0, z.block(i, j, half, half)); }
+				}
+			}
+		});
+	std::cout << "  z(0, 0) = " << z(0, 0) << "\n";
+	benchmark("z = x^T * y",
+		[&] { const Matrix<double> transposed = Matrix<double>(x.t()); gemm(1.0, transposed, y, 0.0, z); },
+		[&] { gemm(1.0, x.t(), y, 0.0, z); });
+	return 0;
+}
@@ -8,6 +8,11 @@
 #include <functional>
 #include <vector>
 #include <memory>
+#include <cstddef>
+#include <new>
+#include <algorithm>
+#include <random>
+#include <chrono>
 
 class Circle
 {
@@ -36,11 +41,13 @@ class ShapeConcept
 	virtual double cost() const = 0;
 };
 
-template<class ShapeType>
-class ShapeModel : public ShapeConcept
+// by default any cost strategy is accepted through std::function;
+// with a concrete CostStrategy the call is direct and can be inlined into cost();
+// every specialization is final, so calls through the model type itself are devirtualized as well
+template<class ShapeType, class CostStrategy = std::function<double(const ShapeType&)>>
+class ShapeModel final : public ShapeConcept
 {
 	public:
-	using CostStrategy = std::function<double(const ShapeType&)>;
 	explicit ShapeModel(ShapeType shape, CostStrategy cost_strategy) : shape_{std::move(shape)}, cost_strategy_{std::move(cost_strategy)} {}
 	virtual double cost() const override
 	{
@@ -89,6 +96,85 @@ double total_cost(const Shapes& shapes)
 	return sum;
 }
 
+class ShapeArena
+{	// bump allocator: memory is taken from large blocks one after the other and only released all together
+	public:
+	explicit ShapeArena(std::size_t block_size = 64 * 1024) : block_size_{block_size} {}
+	ShapeArena(const ShapeArena&) = delete;
+	ShapeArena& operator=(const ShapeArena&) = delete;
+	void* allocate(std::size_t size, std::size_t alignment);
+	private:
+	std::size_t block_size_;
+	std::vector<std::unique_ptr<std::byte[]>> blocks_;
+	void* current_ = nullptr;
+	std::size_t left_ = 0;
+};
+
+void* ShapeArena::allocate(std::size_t size, std::size_t alignment)
+{
+	if(std::align(alignment, size, current_, left_) == nullptr)
+	{	// a new block, large enough for objects bigger than the usual block size
+		const std::size_t block_size = std::max(block_size_, size + alignment);
+		blocks_.push_back(std::make_unique<std::byte[]>(block_size));
+		current_ = blocks_.back().get();
+		left_ = block_size;
+		std::align(alignment, size, current_, left_);
+	}
+	void* object = current_;
+	current_ = static_cast<std::byte*>(current_) + size;
+	left_ -= size;
+	return object;
+}
+
+class ArenaShapes
+{	// same as Shapes, but the models are placed contiguously in an arena, in the order they are added
+	public:
+	ArenaShapes() = default;
+	ArenaShapes(const ArenaShapes&) = delete;
+	ArenaShapes& operator=(const ArenaShapes&) = delete;
+	~ArenaShapes() { for(ShapeConcept* shape : shapes_) { shape->~ShapeConcept(); } }
+	template<class ShapeType, class CostStrategy>
+	void emplace_back(ShapeType shape, CostStrategy cost_strategy)
+	{
+		using Model = ShapeModel<ShapeType, CostStrategy>;
+		void* memory = arena_.allocate(sizeof(Model), alignof(Model));
+		shapes_.push_back(nullptr);	// grows first, so that a constructed model is never left unowned
+		try
+		{
+			shapes_.back() = ::new(memory) Model{std::move(shape), std::move(cost_strategy)};
+		}
+		catch(...)
+		{
+			shapes_.pop_back();
+			throw;
+		}
+	}
+	auto begin() const { return shapes_.begin(); }
+	auto end() const { return shapes_.end(); }
+	std::size_t size() const { return shapes_.size(); }
+	private:
+	ShapeArena arena_;
+	std::vector<ShapeConcept*> shapes_;
+};
+
+double total_cost(const ArenaShapes& shapes)
+{
+	double sum = 0.0;
+	for(const ShapeConcept* shape : shapes)
+	{
+		sum += shape->cost();
+	}
+	return sum;
+}
+
+template<class Function>
+double elapsed_ms(Function function)
+{
+	const auto start = std::chrono::steady_clock::now();
+	function();
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
 int main()
 {
 	using CircleModel = ShapeModel<Circle>;
@@ -103,5 +189,56 @@ int main()
 
 	std::cout << total_cost(shapes) << "\n";
 
+	ArenaShapes arena_shapes{};
+	arena_shapes.emplace_back(Circle{2.5}, AluminumCostStrategy{});
+	arena_shapes.emplace_back(Square{3.0}, SteelCostStrategy{});
+	arena_shapes.emplace_back(Circle{4.0}, SteelCostStrategy{});
+
+	std::cout << total_cost(arena_shapes) << "\n";
+
+	// 2^20 random shapes with random strategies, total cost computed 10 times
+	constexpr std::size_t count = 1 << 20;
+	constexpr int repetitions = 10;
+	std::mt19937 engine{43};
+	std::uniform_int_distribution<int> kind_of{0, 3};
+	std::uniform_real_distribution<double> size_of{1.0, 10.0};
+	Shapes function_shapes{};
+	Shapes template_shapes{};
+	ArenaShapes arena_template_shapes{};
+	for(std::size_t i = 0; i < count; ++i)
+	{
+		const double size = size_of(engine);
+		switch(kind_of(engine))
+		{
+			case 0:
+				function_shapes.emplace_back(std::make_unique<CircleModel>(Circle{size}, AluminumCostStrategy{}));
+				template_shapes.emplace_back(std::make_unique<ShapeModel<Circle, AluminumCostStrategy>>(Circle{size}, AluminumCostStrategy{}));
+				arena_template_shapes.emplace_back(Circle{size}, AluminumCostStrategy{});
+				break;
+			case 1:
+				function_shapes.emplace_back(std::make_unique<CircleModel>(Circle{size}, SteelCostStrategy{}));
+				template_shapes.emplace_back(std::make_unique<ShapeModel<Circle, SteelCostStrategy>>(Circle{size}, SteelCostStrategy{}));
+				arena_template_shapes.emplace_back(Circle{size}, SteelCostStrategy{});
+				break;
+			case 2:
+				function_shapes.emplace_back(std::make_unique<SquareModel>(Square{size}, AluminumCostStrategy{}));
+				template_shapes.emplace_back(std::make_unique<ShapeModel<Square, AluminumCostStrategy>>(Square{size}, AluminumCostStrategy{}));
+				arena_template_shapes.emplace_back(Square{size}, AluminumCostStrategy{});
+				break;
+			default:
+				function_shapes.emplace_back(std::make_unique<SquareModel>(Square{size}, SteelCostStrategy{}));
+				template_shapes.emplace_back(std::make_unique<ShapeModel<Square, SteelCostStrategy>>(Square{size}, SteelCostStrategy{}));
+				arena_template_shapes.emplace_back(Square{size}, SteelCostStrategy{});
+				break;
+		}
+	}
+	double function_sum = 0.0, template_sum = 0.0, arena_sum = 0.0;
+	const double function_ms = elapsed_ms([&] { for(int r = 0; r < repetitions; ++r) { function_sum += total_cost(function_shapes); } }) / repetitions;
+	const double template_ms = elapsed_ms([&] { for(int r = 0; r < repetitions; ++r) { template_sum += total_cost(template_shapes); } }) / repetitions;
+	const double arena_ms = elapsed_ms([&] { for(int r = 0; r < repetitions; ++r) { arena_sum += total_cost(arena_template_shapes); } }) / repetitions;
+	std::cout << "std::function strategy, unique_ptr : " << function_ms << " ms, sizeof(model) " << sizeof(CircleModel) << "\n";
+	std::cout << "template strategy, unique_ptr      : " << template_ms << " ms, sizeof(model) " << sizeof(ShapeModel<Circle, SteelCostStrategy>) << "\n";
+	std::cout << "template strategy, arena           : " << arena_ms << " ms" << (arena_sum == function_sum && template_sum == function_sum ? "" : " (different total)") << "\n";
+
 	return 0;
 }
@@ -0,0 +1,349 @@
+// Reference:
+// Klaus Iglberg.
+// C++ Software Design.
+// Design principles and patterns for high-quality software.
+
+// Functional observer in which slow observers are notified asynchronously on dispatcher threads.
+
+#include <iostream>
+#include <string>
+#include <set>
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <thread>
+#include <functional>
+#include <algorithm>
+#include <chrono>
+#include <stdexcept>
+
+template<class Type>
+class BoundedMpscQueue
+{	// lock-free ring buffer for many producers and a single consumer (D. Vyukov's bounded queue)
+	// every cell carries a sequence number telling whether it is ready to be written or read
+	public:
+	explicit BoundedMpscQueue(std::size_t capacity);
+	bool try_push(const Type&);
+	// consumer only
+	bool try_pop(Type&);
+	private:
+	struct Cell
+	{
+		std::atomic<std::size_t> sequence;
+		Type value;
+	};
+	std::size_t mask_;
+	std::unique_ptr<Cell[]> cells_;
+	// producers and consumer write to different cache lines
+	alignas(64) std::atomic<std::size_t> tail_{0};
+	alignas(64) std::size_t head_{0};
+};
+
+template<class Type>
+BoundedMpscQueue<Type>::BoundedMpscQueue(std::size_t capacity) : mask_{capacity - 1}, cells_{std::make_unique<Cell[]>(capacity)}
+{
+	if(capacity < 2 || (capacity & mask_) != 0) throw std::invalid_argument("capacity has to be a power of two");
+	for(std::size_t i = 0; i < capacity; ++i) { cells_[i].sequence.store(i, std::memory_order_relaxed); }
+}
+
+template<class Type>
+bool BoundedMpscQueue<Type>::try_push(const Type& value)
+{
+	std::size_t position = tail_.load(std::memory_order_relaxed);
+	Cell* cell;
+	for(;;)
+	{
+		cell = &cells_[position & mask_];
+		const std::size_t sequence = cell->sequence.load(std::memory_order_acquire);
+		const auto difference = static_cast<std::ptrdiff_t>(sequence) - static_cast<std::ptrdiff_t>(position);
+		if(difference == 0)
+		{	// cell is free, claim it
+			if(tail_.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) break;
+		}
+		else if(difference < 0) return false; // full
+		else position = tail_.load(std::memory_order_relaxed); // another producer claimed it
+	}
+	cell->value = value;
+	cell->sequence.store(position + 1, std::memory_order_release);
+	return true;
+}
+
+template<class Type>
+bool BoundedMpscQueue<Type>::try_pop(Type& value)
+{
+	Cell& cell = cells_[head_ & mask_];
+	if(cell.sequence.load(std::memory_order_acquire) != head_ + 1) return false; // empty
+	value = cell.value;
+	// free the cell for the producers of the next lap
+	cell.sequence.store(head_ + mask_ + 1, std::memory_order_release);
+	++head_;
+	return true;
+}
+
+template<class Observed, class StateTag>
+class Observer
+{
+	public:
+	using callback_type = std::function<void(const Observed&, StateTag)>;
+	explicit Observer(callback_type callback) : callback_{std::move(callback)} {}
+	void update(const Observed& observed, StateTag property)
+	{
+		callback_(observed, property);
+	}
+	private:
+	callback_type callback_;
+};
+
+template<class Observed, class StateTag>
+class AsyncDispatcher
+{	// delivers notifications on its own threads, one queue per thread
+	// notifications of the same subject always go to the same thread, so their order is preserved
+	public:
+	using ObserverType = Observer<Observed, StateTag>;
+	// what to do when the queue is full; delivering on the notifying thread instead is not offered,
+	// it would overtake the notifications still queued for the subject and race with the dispatcher thread
+	enum class Backpressure
+	{
+		block,	// wait for free space
+		drop	// discard the notification
+	};
+	explicit AsyncDispatcher(std::size_t thread_count = 1, std::size_t queue_capacity = 1024, Backpressure backpressure = Backpressure::block);
+	~AsyncDispatcher();
+	AsyncDispatcher(const AsyncDispatcher&) = delete;
+	AsyncDispatcher& operator=(const AsyncDispatcher&) = delete;
+	// observer to be attached instead of target, target is updated on a dispatcher thread
+	// note that the subject may have changed again by the time target reads it
+	ObserverType make_async(ObserverType& target)
+	{
+		return ObserverType{[this, &target](const Observed& observed, StateTag property) { post(observed, property, target); }};
+	}
+	void post(const Observed&, StateTag, ObserverType&);
+	// blocks until every posted notification has been delivered
+	void wait_idle() const;
+	std::size_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+	private:
+	struct Event
+	{
+		const Observed* subject;
+		StateTag property;
+		ObserverType* target;
+	};
+	struct Lane
+	{
+		explicit Lane(std::size_t capacity) : queue{capacity} {}
+		BoundedMpscQueue<Event> queue;
+		alignas(64) std::atomic<std::size_t> posted{0};
+		alignas(64) std::atomic<std::size_t> delivered{0};
+	};
+	void run(Lane&);
+	Backpressure backpressure_;
+	std::atomic<bool> stopping_{false};
+	std::atomic<std::size_t> dropped_{0};
+	std::vector<std::unique_ptr<Lane>> lanes_;
+	std::vector<std::thread> threads_;
+};
+
+template<class Observed, class StateTag>
+AsyncDispatcher<Observed, StateTag>::AsyncDispatcher(std::size_t thread_count, std::size_t queue_capacity, Backpressure backpressure) : backpressure_{backpressure}
+{
+	for(std::size_t i = 0; i < thread_count; ++i) { lanes_.push_back(std::make_unique<Lane>(queue_capacity)); }
+	for(auto& lane : lanes_) { threads_.emplace_back([this, &lane = *lane] { run(lane); }); }
+}
+
+template<class Observed, class StateTag>
+AsyncDispatcher<Observed, StateTag>::~AsyncDispatcher()
+{	// pending notifications are delivered before the threads stop
+	stopping_.store(true, std::memory_order_release);
+	for(auto& thread : threads_) { thread.join(); }
+}
+
+template<class Observed, class StateTag>
+void AsyncDispatcher<Observed, StateTag>::post(const Observed& subject, StateTag property, ObserverType& target)
+{
+	Lane& lane = *lanes_[std::hash<const Observed*>{}(&subject) % lanes_.size()];
+	const Event event{&subject, property, &target};
+	lane.posted.fetch_add(1, std::memory_order_relaxed);
+	while(!lane.queue.try_push(event))
+	{
+		if(backpressure_ == Backpressure::block) { std::this_thread::yield(); continue; }
+		dropped_.fetch_add(1, std::memory_order_relaxed);
+		lane.delivered.fetch_add(1, std::memory_order_release);
+		return;
+	}
+}
+
+template<class Observed, class StateTag>
+void AsyncDispatcher<Observed, StateTag>::run(Lane& lane)
+{
+	Event event;
+	std::size_t idle_rounds = 0;
+	for(;;)
+	{
+		if(lane.queue.try_pop(event))
+		{
+			event.target->update(*event.subject, event.property);
+			lane.delivered.fetch_add(1, std::memory_order_release);
+			idle_rounds = 0;
+		}
+		else if(stopping_.load(std::memory_order_acquire) && lane.delivered.load(std::memory_order_acquire) == lane.posted.load(std::memory_order_acquire)) return;
+		else if(++idle_rounds < 64) std::this_thread::yield();
+		else std::this_thread::sleep_for(std::chrono::microseconds(50));
+	}
+}
+
+template<class Observed, class StateTag>
+void AsyncDispatcher<Observed, StateTag>::wait_idle() const
+{
+	for(const auto& lane : lanes_)
+	{
+		while(lane->delivered.load(std::memory_order_acquire) != lane->posted.load(std::memory_order_acquire)) { std::this_thread::yield(); }
+	}
+}
+
+class Person
+{
+	public:
+	enum StateChange
+	{
+		forename_changed,
+		surname_changed,
+		address_changed
+	};
+	using PersonObserver = Observer<Person, StateChange>;
+	explicit Person(std::string forename, std::string surname) : forename_{std::move(forename)}, surname_{std::move(surname)} {}
+	bool attach(PersonObserver*);
+	bool detach(PersonObserver*);
+	void notify(StateChange);
+	void forename(std::string);
+	void surname(std::string);
+	void address(std::string);
+	const std::string& forename() const { return forename_; }
+	const std::string& surname() const { return surname_; }
+	const std::string& address() const { return address_; }
+	private:
+	std::string forename_;
+	std::string surname_;
+	std::string address_;
+	std::set<PersonObserver*> observers_;
+};
+
+bool Person::attach(PersonObserver* observer)
+{
+	auto [pos, success] = observers_.insert(observer);
+	return success;
+}
+
+bool Person::detach(PersonObserver* observer)
+{
+	return (observers_.erase(observer)) > 0;
+}
+
+void Person::notify(StateChange property)
+{	// asynchronous observers return as soon as the notification is queued
+	for(const auto& observer : observers_)
+	{
+		observer->update(*this, property);
+	}
+}
+
+void Person::forename(std::string forename)
+{
+	forename_ = std::move(forename);
+	notify(forename_changed);
+}
+
+void Person::surname(std::string surname)
+{
+	surname_ = std::move(surname);
+	notify(surname_changed);
+}
+
+void Person::address(std::string address)
+{
+	address_ = std::move(address);
+	notify(address_changed);
+}
+
+void on_name_update(const Person& person, Person::StateChange property)
+{
+	if(property == Person::forename_changed || property == Person::surname_changed)
+	{
+		std::cout << "Updated name of the person is " << person.forename() << " " << person.surname() << "!\n";
+	}
+}
+
+void on_address_update(const Person& person, Person::StateChange property)
+{
+	if(property == Person::address_changed)
+	{
+		std::cout << "Address of " << person.forename() << " " << person.surname() << " has been changed!\n";
+	}
+}
+
+void slow_update(const Person&, Person::StateChange)
+{	// e.g. logging or I/O
+	std::this_thread::sleep_for(std::chrono::microseconds(20));
+}
+
+void print_setter_latency(const char* title, Person& person, std::size_t setters)
+{
+	std::vector<double> latencies(setters);
+	for(std::size_t i = 0; i < setters; ++i)
+	{
+		const auto start = std::chrono::steady_clock::now();
+		person.address("Queens");
+		latencies[i] = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+		// setters arrive at a rate the dispatcher can keep up with on average
+		std::this_thread::sleep_until(start + std::chrono::microseconds(500));
+	}
+	std::sort(latencies.begin(), latencies.end());
+	const auto percentile = [&](double p) { return latencies[static_cast<std::size_t>(p * (setters - 1))]; };
+	std::cout << title << ": p50 " << percentile(0.5) << " us, p99 " << percentile(0.99) << " us, p99.9 " << percentile(0.999) << " us, max " << latencies.back() << " us\n";
+}
+
+int main()
+{
+	using Dispatcher = AsyncDispatcher<Person, Person::StateChange>;
+	Person::PersonObserver name_observer{on_name_update};
+	Person::PersonObserver address_observer{on_address_update};
+
+	{
+		Dispatcher dispatcher{};
+		Person::PersonObserver async_address_observer = dispatcher.make_async(address_observer);
+
+		Person tony("Tony", "Stark");
+		Person alanna("Alanna", "Mitsopolis");
+
+		tony.attach(&name_observer);
+		alanna.attach(&name_observer);
+		alanna.attach(&async_address_observer);
+
+		tony.forename("Tony Ironman");
+		alanna.forename("Alanna White-Widow");
+
+		tony.address("Stark Industries");
+		alanna.address("Earth");
+		dispatcher.wait_idle();
+	}
+
+	// setter latency with three slow observers attached
+	constexpr std::size_t setters = 2000;
+	Person::PersonObserver slow_observers[] = {Person::PersonObserver{slow_update}, Person::PersonObserver{slow_update}, Person::PersonObserver{slow_update}};
+	{
+		Person peter("Peter", "Parker");
+		for(auto& observer : slow_observers) { peter.attach(&observer); }
+		print_setter_latency("synchronous        ", peter, setters);
+	}
+	for(const auto backpressure : {Dispatcher::Backpressure::block, Dispatcher::Backpressure::drop})
+	{
+		Dispatcher dispatcher{1, 1024, backpressure};
+		std::vector<Person::PersonObserver> async_observers;
+		for(auto& observer : slow_observers) { async_observers.push_back(dispatcher.make_async(observer)); }
+		Person peter("Peter", "Parker");
+		for(auto& observer : async_observers) { peter.attach(&observer); }
+		print_setter_latency(backpressure == Dispatcher::Backpressure::block ? "asynchronous, block" : "asynchronous, drop ", peter, setters);
+		dispatcher.wait_idle();
+		std::cout << "  dropped " << dispatcher.dropped() << " notifications\n";
+	}
+	return 0;
+}
@@ -0,0 +1,209 @@
+// Reference:
+// Klaus Iglberg.
+// C++ Software Design.
+// Design principles and patterns for high-quality software.
+
+// Functional observer in which several state changes can be coalesced into a single notification.
+
+#include <iostream>
+#include <string>
+#include <set>
+#include <functional>
+#include <chrono>
+
+template<class Observed, class StateTag>
+class Observer
+{
+	public:
+	using callback_type = std::function<void(const Observed&, StateTag)>;
+	explicit Observer(callback_type callback) : callback_{std::move(callback)} {}
+	void update(const Observed& observed, StateTag property)
+	{
+		callback_(observed, property);
+	}
+	private:
+	callback_type callback_;
+};
+
+class Person
+{
+	public:
+	// values are bit flags so that several changes can be reported at once
+	enum StateChange : unsigned
+	{
+		forename_changed = 1u << 0,
+		surname_changed = 1u << 1,
+		address_changed = 1u << 2
+	};
+	using StateChanges = unsigned;
+	using PersonObserver = Observer<Person, StateChanges>;
+	class BatchUpdate;
+	explicit Person(std::string forename, std::string surname) : forename_{std::move(forename)}, surname_{std::move(surname)} {}
+	bool attach(PersonObserver*);
+	bool detach(PersonObserver*);
+	void notify(StateChanges);
+	// notifications are deferred until the returned scope ends, then each observer is notified once with all changes
+	[[nodiscard]] BatchUpdate batch_update();
+	void forename(std::string);
+	void surname(std::string);
+	void address(std::string);
+	const std::string& forename() const { return forename_; }
+	const std::string& surname() const { return surname_; }
+	const std::string& address() const { return address_; }
+	private:
+	void changed(StateChange);
+	std::string forename_;
+	std::string surname_;
+	std::string address_;
+	std::set<PersonObserver*> observers_;
+	// nesting depth of batch updates and the changes collected so far
+	unsigned batch_depth_ = 0;
+	StateChanges pending_ = 0;
+};
+
+class Person::BatchUpdate
+{	// RAII, batches can be nested and only the outermost one notifies
+	public:
+	explicit BatchUpdate(Person& person) : person_{&person} { ++person_->batch_depth_; }
+	BatchUpdate(const BatchUpdate&) = delete;
+	BatchUpdate& operator=(const BatchUpdate&) = delete;
+	~BatchUpdate();
+	private:
+	Person* person_;
+};
+
+Person::BatchUpdate::~BatchUpdate()
+{	// note that an observer throwing from here would terminate the program
+	if(--person_->batch_depth_ != 0 || person_->pending_ == 0) return;
+	const StateChanges changes = person_->pending_;
+	person_->pending_ = 0;
+	person_->notify(changes);
+}
+
+Person::BatchUpdate Person::batch_update()
+{	// guaranteed copy elision, BatchUpdate need not be movable
+	return BatchUpdate{*this};
+}
+
+bool Person::attach(PersonObserver* observer)
+{
+	auto [pos, success] = observers_.insert(observer);
+	return success;
+}
+
+bool Person::detach(PersonObserver* observer)
+{
+	return (observers_.erase(observer)) > 0;
+}
+
+void Person::notify(StateChanges properties)
+{
+	for(const auto& observer : observers_)
+	{
+		observer->update(*this, properties);
+	}
+}
+
+void Person::changed(StateChange property)
+{
+	if(batch_depth_ == 0) { notify(property); }
+	else { pending_ |= property; }
+}
+
+void Person::forename(std::string forename)
+{
+	forename_ = std::move(forename);
+	changed(forename_changed);
+}
+
+void Person::surname(std::string surname)
+{
+	surname_ = std::move(surname);
+	changed(surname_changed);
+}
+
+void Person::address(std::string address)
+{
+	address_ = std::move(address);
+	changed(address_changed);
+}
+
+void on_name_update(const Person& person, Person::StateChanges properties)
+{
+	if(properties & (Person::forename_changed | Person::surname_changed))
+	{
+		std::cout << "Updated name of the person is " << person.forename() << " " << person.surname() << "!\n";
+	}
+}
+
+void on_address_update(const Person& person, Person::StateChanges properties)
+{
+	if(properties & Person::address_changed)
+	{
+		std::cout << "Address of " << person.forename() << " " << person.surname() << " has been changed!\n";
+	}
+}
+
+template<class Function>
+double elapsed_ms(Function function)
+{
+	const auto start = std::chrono::steady_clock::now();
+	function();
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main()
+{
+	Person::PersonObserver name_observer{on_name_update};
+	Person::PersonObserver address_observer{on_address_update};
+
+	Person tony("Tony", "Stark");
+	Person alanna("Alanna", "Mitsopolis");
+
+	tony.attach(&name_observer);
+	alanna.attach(&name_observer);
+	alanna.attach(&address_observer);
+
+	tony.forename("Tony Ironman");
+	tony.address("Stark Industries");
+	{	// name observer reports the new name once
+		auto batch = alanna.batch_update();
+		alanna.forename("Natasha");
+		alanna.surname("Romanoff");
+		alanna.address("Earth");
+	}
+
+	// bulk record update, three setters per record with and without a batch
+	constexpr std::size_t records = 1000000;
+	std::size_t invocations = 0;
+	Person::PersonObserver counting_observers[] = {
+		Person::PersonObserver{[&invocations](const Person&, Person::StateChanges) { ++invocations; }},
+		Person::PersonObserver{[&invocations](const Person&, Person::StateChanges) { ++invocations; }},
+		Person::PersonObserver{[&invocations](const Person&, Person::StateChanges) { ++invocations; }}
+	};
+	Person peter("Peter", "Parker");
+	for(auto& observer : counting_observers) { peter.attach(&observer); }
+
+	const double separate_ms = elapsed_ms([&] {
+		for(std::size_t i = 0; i < records; ++i)
+		{
+			peter.forename("Peter");
+			peter.surname("Parker");
+			peter.address("Queens");
+		}
+	});
+	const std::size_t separate_invocations = invocations;
+	invocations = 0;
+	const double batched_ms = elapsed_ms([&] {
+		for(std::size_t i = 0; i < records; ++i)
+		{
+			auto batch = peter.batch_update();
+			peter.forename("Peter");
+			peter.surname("Parker");
+			peter.address("Queens");
+		}
+	});
+	std::cout << "separate : " << separate_ms << " ms, " << separate_invocations << " observer invocations\n";
+	std::cout << "batched  : " << batched_ms << " ms, " << invocations << " observer invocations\n";
+	return 0;
+}
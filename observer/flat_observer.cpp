@@ -0,0 +1,239 @@
+// Reference:
+// Klaus Iglberg.
+// C++ Software Design.
+// Design principles and patterns for high-quality software.
+
+// Same as functional_observer.cpp except for the container the observers are stored in.
+
+#include <iostream>
+#include <string>
+#include <set>
+#include <array>
+#include <vector>
+#include <algorithm>
+#include <functional>
+#include <type_traits>
+#include <chrono>
+
+template<class Type, std::size_t InlineCapacity>
+class SmallFlatSet
+{	// sorted vector whose first InlineCapacity elements are stored inline (no allocation)
+	// elements are moved to the heap all together once the inline capacity is exceeded
+	static_assert(std::is_trivially_copyable_v<Type>, "elements are expected to be cheap to copy, e.g. pointers");
+	public:
+	using iterator = const Type*;
+	bool insert(Type);
+	bool erase(Type);
+	iterator begin() const { return data(); }
+	iterator end() const { return data() + size_; }
+	std::size_t size() const { return size_; }
+	bool empty() const { return size_ == 0; }
+	private:
+	bool is_inline() const { return size_ <= InlineCapacity; }
+	const Type* data() const { return is_inline() ? inline_.data() : heap_.data(); }
+	std::size_t size_ = 0;
+	std::array<Type, InlineCapacity> inline_{};
+	std::vector<Type> heap_;
+};
+
+template<class Type, std::size_t InlineCapacity>
+bool SmallFlatSet<Type, InlineCapacity>::insert(Type element)
+{
+	const auto position = std::lower_bound(begin(), end(), element);
+	if(position != end() && *position == element) return false;
+	const auto offset = position - begin();
+	if(size_ < InlineCapacity)
+	{
+		std::copy_backward(inline_.begin() + offset, inline_.begin() + size_, inline_.begin() + size_ + 1);
+		inline_[offset] = element;
+	}
+	else if(size_ == InlineCapacity)
+	{	// spill to the heap
+		heap_.reserve(2 * InlineCapacity);
+		heap_.assign(inline_.begin(), inline_.end());
+		heap_.insert(heap_.begin() + offset, element);
+	}
+	else
+	{
+		heap_.insert(heap_.begin() + offset, element);
+	}
+	++size_;
+	return true;
+}
+
+template<class Type, std::size_t InlineCapacity>
+bool SmallFlatSet<Type, InlineCapacity>::erase(Type element)
+{
+	const auto position = std::lower_bound(begin(), end(), element);
+	if(position == end() || *position != element) return false;
+	const auto offset = position - begin();
+	if(is_inline())
+	{
+		std::copy(inline_.begin() + offset + 1, inline_.begin() + size_, inline_.begin() + offset);
+	}
+	else
+	{
+		heap_.erase(heap_.begin() + offset);
+		if(heap_.size() == InlineCapacity)
+		{	// back to inline storage, heap capacity is kept for the next spill
+			std::copy(heap_.begin(), heap_.end(), inline_.begin());
+			heap_.clear();
+		}
+	}
+	--size_;
+	return true;
+}
+
+template<class Observed, class StateTag>
+class Observer
+{
+	public:
+	using callback_type = std::function<void(const Observed&, StateTag)>;
+	explicit Observer(callback_type callback) : callback_{std::move(callback)} {}
+	void update(const Observed& observed, StateTag property)
+	{
+		callback_(observed, property);
+	}
+	private:
+	callback_type callback_;
+};
+
+class Person
+{
+	public:
+	enum StateChange
+	{
+		forename_changed,
+		surname_changed,
+		address_changed
+	};
+	using PersonObserver = Observer<Person, StateChange>;
+	explicit Person(std::string forename, std::string surname) : forename_{std::move(forename)}, surname_{std::move(surname)} {}
+	bool attach(PersonObserver*);
+	bool detach(PersonObserver*);
+	void notify(StateChange);
+	void forename(std::string);
+	void surname(std::string);
+	void address(std::string);
+	const std::string& forename() const { return forename_; }
+	const std::string& surname() const { return surname_; }
+	const std::string& address() const { return address_; }
+	private:
+	std::string forename_;
+	std::string surname_;
+	std::string address_;
+	// most persons are observed by a handful of observers
+	SmallFlatSet<PersonObserver*, 4> observers_;
+};
+
+bool Person::attach(PersonObserver* observer)
+{
+	return observers_.insert(observer);
+}
+
+bool Person::detach(PersonObserver* observer)
+{
+	return observers_.erase(observer);
+}
+
+void Person::notify(StateChange property)
+{	// observers are iterated in the same (address) order as std::set would do
+	for(const auto& observer : observers_)
+	{
+		observer->update(*this, property);
+	}
+}
+
+void Person::forename(std::string forename)
+{
+	forename_ = std::move(forename);
+	notify(forename_changed);
+}
+
+void Person::surname(std::string surname)
+{
+	surname_ = std::move(surname);
+	notify(surname_changed);
+}
+
+void Person::address(std::string address)
+{
+	address_ = std::move(address);
+	notify(address_changed);
+}
+
+void on_name_update(const Person& person, Person::StateChange property)
+{
+	if(property == Person::forename_changed || property == Person::surname_changed)
+	{
+		std::cout << "Updated name of the person is " << person.forename() << " " << person.surname() << "!\n";
+	}
+}
+
+void on_address_update(const Person& person, Person::StateChange property)
+{
+	if(property == Person::address_changed)
+	{
+		std::cout << "Address of " << person.forename() << " " << person.surname() << " has been changed!\n";
+	}
+}
+
+template<class Function>
+double elapsed_ns(Function function, std::size_t operations)
+{
+	const auto start = std::chrono::steady_clock::now();
+	function();
+	return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / operations;
+}
+
+template<class Storage>
+void benchmark(const char* title, std::vector<Person::PersonObserver>& observers, const Person& person)
+{	// attach all, notify and detach all, repeated with fresh storage as a person would do
+	constexpr std::size_t repetitions = 200000;
+	std::vector<Storage> storages(repetitions / 100);
+	double attach_ns = 0.0, notify_ns = 0.0, detach_ns = 0.0;
+	for(std::size_t round = 0; round < 100; ++round)
+	{
+		attach_ns += elapsed_ns([&] {
+			for(auto& storage : storages) { for(auto& observer : observers) { storage.insert(&observer); } }
+		}, storages.size() * observers.size());
+		notify_ns += elapsed_ns([&] {
+			for(auto& storage : storages) { for(auto* observer : storage) { observer->update(person, Person::address_changed); } }
+		}, storages.size());
+		detach_ns += elapsed_ns([&] {
+			for(auto& storage : storages) { for(auto& observer : observers) { storage.erase(&observer); } }
+		}, storages.size() * observers.size());
+	}
+	std::cout << "  " << title << ": attach " << attach_ns / 100 << " ns, detach " << detach_ns / 100 << " ns, notify (all observers) " << notify_ns / 100 << " ns\n";
+}
+
+int main()
+{
+	Person::PersonObserver name_observer{on_name_update};
+	Person::PersonObserver address_observer{on_address_update};
+
+	Person tony("Tony", "Stark");
+	Person alanna("Alanna", "Mitsopolis");
+
+	tony.attach(&name_observer);
+	alanna.attach(&name_observer);
+	alanna.attach(&address_observer);
+
+	tony.forename("Tony Ironman");
+	alanna.forename("Alanna White-Widow");
+
+	tony.address("Stark Industries");
+	alanna.address("Earth");
+
+	// benchmark against std::set, per observer for attach/detach and per person for notify
+	std::size_t counter = 0;
+	for(std::size_t observer_count : {1, 4, 16})
+	{
+		std::vector<Person::PersonObserver> observers(observer_count, Person::PersonObserver{[&counter](const Person&, Person::StateChange) { ++counter; }});
+		std::cout << observer_count << " observer(s)\n";
+		benchmark<std::set<Person::PersonObserver*>>("std::set     ", observers, tony);
+		benchmark<SmallFlatSet<Person::PersonObserver*, 4>>("SmallFlatSet ", observers, tony);
+	}
+	std::cout << counter << " updates\n";
+	return 0;
+}
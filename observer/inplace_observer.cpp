@@ -0,0 +1,283 @@
+// Reference:
+// Klaus Iglberg.
+// C++ Software Design.
+// Design principles and patterns for high-quality software.
+
+// Functional observer whose callback is stored without dynamic memory allocation.
+
+#include <iostream>
+#include <string>
+#include <set>
+#include <vector>
+#include <new>
+#include <memory>
+#include <cstddef>
+#include <functional>
+#include <type_traits>
+#include <chrono>
+
+template<class Signature, std::size_t Capacity = 32> class InplaceFunction;
+
+template<class ReturnType, class ...Args, std::size_t Capacity>
+class InplaceFunction<ReturnType(Args...), Capacity>
+{	// type erasure with a fixed size inline buffer instead of a heap allocated model
+	// the call goes through a single function pointer stored in the object itself
+	private:
+	template<class StoredType>
+	static constexpr bool fits = sizeof(StoredType) <= Capacity && alignof(StoredType) <= alignof(std::max_align_t)
+		&& std::is_nothrow_move_constructible_v<StoredType>;
+	public:
+	// a callable which does not fit into the inline storage, or may throw when moved, is rejected,
+	// increase Capacity or refer to it by FunctionRef
+	template<class CallableType>
+	requires (!std::is_same_v<std::remove_cvref_t<CallableType>, InplaceFunction>) && std::is_invocable_r_v<ReturnType, std::decay_t<CallableType>&, Args...>
+		&& fits<std::decay_t<CallableType>>
+	InplaceFunction(CallableType&& callable) : invoke_{&invoke<std::decay_t<CallableType>>}, manager_{&manage<std::decay_t<CallableType>>}
+	{
+		::new(static_cast<void*>(storage_)) std::decay_t<CallableType>(std::forward<CallableType>(callable));
+	}
+	InplaceFunction(const InplaceFunction& other) : invoke_{other.invoke_}, manager_{other.manager_}
+	{
+		manager_(Operation::copy, storage_, const_cast<std::byte*>(other.storage_));
+	}
+	// the source keeps its moved-from callable
+	InplaceFunction(InplaceFunction&& other) noexcept : invoke_{other.invoke_}, manager_{other.manager_}
+	{
+		manager_(Operation::move, storage_, other.storage_);
+	}
+	// if the copy throws, *this is left empty and calling it throws std::bad_function_call
+	InplaceFunction& operator=(const InplaceFunction& other)
+	{
+		if(this != &other)
+		{
+			reset();
+			other.manager_(Operation::copy, storage_, const_cast<std::byte*>(other.storage_));
+			invoke_ = other.invoke_;
+			manager_ = other.manager_;
+		}
+		return *this;
+	}
+	InplaceFunction& operator=(InplaceFunction&& other) noexcept
+	{
+		if(this != &other)
+		{
+			reset();
+			other.manager_(Operation::move, storage_, other.storage_);
+			invoke_ = other.invoke_;
+			manager_ = other.manager_;
+		}
+		return *this;
+	}
+	~InplaceFunction() { manager_(Operation::destroy, storage_, nullptr); }
+	ReturnType operator()(Args... args) { return invoke_(storage_, std::forward<Args>(args)...); }
+	private:
+	enum class Operation { copy, move, destroy };
+	void reset() noexcept
+	{
+		manager_(Operation::destroy, storage_, nullptr);
+		invoke_ = &invoke_empty;
+		manager_ = &manage_empty;
+	}
+	template<class StoredType>
+	static ReturnType invoke(void* storage, Args... args)
+	{
+		return std::invoke(*std::launder(static_cast<StoredType*>(storage)), std::forward<Args>(args)...);
+	}
+	static ReturnType invoke_empty(void*, Args...) { throw std::bad_function_call{}; }
+	template<class StoredType>
+	static void manage(Operation operation, void* storage, void* source)
+	{	// constructs storage from source, or destroys storage
+		switch(operation)
+		{
+			case Operation::copy: ::new(storage) StoredType(*std::launder(static_cast<const StoredType*>(source))); break;
+			case Operation::move: ::new(storage) StoredType(std::move(*std::launder(static_cast<StoredType*>(source)))); break;
+			case Operation::destroy: std::launder(static_cast<StoredType*>(storage))->~StoredType(); break;
+		}
+	}
+	static void manage_empty(Operation, void*, void*) {}
+	ReturnType (*invoke_)(void*, Args...);
+	void (*manager_)(Operation, void*, void*);
+	alignas(std::max_align_t) std::byte storage_[Capacity];
+};
+
+template<class Signature> class FunctionRef;
+
+template<class ReturnType, class ...Args>
+class FunctionRef<ReturnType(Args...)>
+{	// non-owning, a function pointer plus the context it is called with
+	// the referred callable has to outlive the FunctionRef
+	public:
+	FunctionRef(ReturnType (*function)(Args...)) : invoke_{&call_function}
+	{
+		context_.function = function;
+	}
+	template<class CallableType>
+	requires (!std::is_same_v<std::remove_cvref_t<CallableType>, FunctionRef>) && std::is_invocable_r_v<ReturnType, CallableType&, Args...>
+	FunctionRef(CallableType& callable) : invoke_{&call_object<CallableType>}
+	{
+		context_.object = const_cast<void*>(static_cast<const void*>(std::addressof(callable)));
+	}
+	ReturnType operator()(Args... args) const { return invoke_(context_, std::forward<Args>(args)...); }
+	private:
+	union Context
+	{
+		void* object;
+		ReturnType (*function)(Args...);
+	};
+	static ReturnType call_function(Context context, Args... args)
+	{
+		return context.function(std::forward<Args>(args)...);
+	}
+	template<class CallableType>
+	static ReturnType call_object(Context context, Args... args)
+	{
+		return std::invoke(*static_cast<CallableType*>(context.object), std::forward<Args>(args)...);
+	}
+	Context context_;
+	ReturnType (*invoke_)(Context, Args...);
+};
+
+template<class Observed, class StateTag, class Callback = InplaceFunction<void(const Observed&, StateTag)>>
+class Observer
+{
+	public:
+	using callback_type = Callback;
+	explicit Observer(callback_type callback) : callback_{std::move(callback)} {}
+	void update(const Observed& observed, StateTag property)
+	{
+		callback_(observed, property);
+	}
+	private:
+	callback_type callback_;
+};
+
+class Person
+{
+	public:
+	enum StateChange
+	{
+		forename_changed,
+		surname_changed,
+		address_changed
+	};
+	using PersonObserver = Observer<Person, StateChange>;
+	explicit Person(std::string forename, std::string surname) : forename_{std::move(forename)}, surname_{std::move(surname)} {}
+	bool attach(PersonObserver*);
+	bool detach(PersonObserver*);
+	void notify(StateChange);
+	void forename(std::string);
+	void surname(std::string);
+	void address(std::string);
+	const std::string& forename() const { return forename_; }
+	const std::string& surname() const { return surname_; }
+	const std::string& address() const { return address_; }
+	private:
+	std::string forename_;
+	std::string surname_;
+	std::string address_;
+	std::set<PersonObserver*> observers_;
+};
+
+bool Person::attach(PersonObserver* observer)
+{
+	auto [pos, success] = observers_.insert(observer);
+	return success;
+}
+
+bool Person::detach(PersonObserver* observer)
+{
+	return (observers_.erase(observer)) > 0;
+}
+
+void Person::notify(StateChange property)
+{
+	for(const auto& observer : observers_)
+	{
+		observer->update(*this, property);
+	}
+}
+
+void Person::forename(std::string forename)
+{
+	forename_ = std::move(forename);
+	notify(forename_changed);
+}
+
+void Person::surname(std::string surname)
+{
+	surname_ = std::move(surname);
+	notify(surname_changed);
+}
+
+void Person::address(std::string address)
+{
+	address_ = std::move(address);
+	notify(address_changed);
+}
+
+void on_name_update(const Person& person, Person::StateChange property)
+{
+	if(property == Person::forename_changed || property == Person::surname_changed)
+	{
+		std::cout << "Updated name of the person is " << person.forename() << " " << person.surname() << "!\n";
+	}
+}
+
+void on_address_update(const Person& person, Person::StateChange property)
+{
+	if(property == Person::address_changed)
+	{
+		std::cout << "Address of " << person.forename() << " " << person.surname() << " has been changed!\n";
+	}
+}
+
+template<class Callback>
+void benchmark(const char* title, const Person& person)
+{	// notify throughput with eight observers capturing three references each (too large for the buffer of std::function)
+	using ObserverType = Observer<Person, Person::StateChange, Callback>;
+	constexpr std::size_t rounds = 5000000;
+	std::size_t names = 0, addresses = 0, others = 0;
+	auto counting = [&names, &addresses, &others](const Person&, Person::StateChange property) {
+		if(property == Person::address_changed) ++addresses;
+		else if(property == Person::forename_changed) ++names;
+		else ++others;
+	};
+	std::vector<ObserverType> observers(8, ObserverType{Callback{counting}});
+	std::vector<ObserverType*> attached;
+	for(auto& observer : observers) { attached.push_back(&observer); }
+	const auto start = std::chrono::steady_clock::now();
+	for(std::size_t i = 0; i < rounds; ++i)
+	{
+		for(auto* observer : attached) { observer->update(person, static_cast<Person::StateChange>(i % 3)); }
+	}
+	const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	std::cout << "  " << title << ": sizeof(Observer) " << sizeof(ObserverType) << " bytes, " << (names + addresses + others) / seconds / 1e6 << " M updates/s\n";
+}
+
+int main()
+{
+	Person::PersonObserver name_observer{on_name_update};
+	Person::PersonObserver address_observer{on_address_update};
+
+	Person tony("Tony", "Stark");
+	Person alanna("Alanna", "Mitsopolis");
+
+	tony.attach(&name_observer);
+	alanna.attach(&name_observer);
+	alanna.attach(&address_observer);
+
+	tony.forename("Tony Ironman");
+	alanna.forename("Alanna White-Widow");
+
+	tony.address("Stark Industries");
+	alanna.address("Earth");
+
+	// Person::PersonObserver too_large{[a = std::array<double, 8>{}](const Person&, Person::StateChange) {}}; // does not compile
+
+	std::cout << "notify throughput\n";
+	using Signature = void(const Person&, Person::StateChange);
+	benchmark<std::function<Signature>>("std::function  ", tony);
+	benchmark<InplaceFunction<Signature>>("InplaceFunction", tony);
+	benchmark<FunctionRef<Signature>>("FunctionRef    ", tony);
+	return 0;
+}
@@ -0,0 +1,196 @@
+// Reference:
+// Klaus Iglberg.
+// C++ Software Design.
+// Design principles and patterns for high-quality software.
+
+// Functional observer in which observers subscribe only to the state changes they are interested in.
+
+#include <iostream>
+#include <string>
+#include <array>
+#include <vector>
+#include <algorithm>
+#include <functional>
+#include <chrono>
+
+template<class Observed, class StateTag>
+class Observer
+{
+	public:
+	using callback_type = std::function<void(const Observed&, StateTag)>;
+	explicit Observer(callback_type callback) : callback_{std::move(callback)} {}
+	void update(const Observed& observed, StateTag property)
+	{
+		callback_(observed, property);
+	}
+	private:
+	callback_type callback_;
+};
+
+class Person
+{
+	public:
+	enum StateChange
+	{
+		forename_changed,
+		surname_changed,
+		address_changed
+	};
+	// not an enumerator, so that it cannot be passed as a state change
+	static constexpr std::size_t state_change_count = address_changed + 1;
+	// bitmask of StateChange values
+	using Interests = unsigned;
+	static constexpr Interests interest(StateChange property) { return 1u << property; }
+	static constexpr Interests name_interests = (1u << forename_changed) | (1u << surname_changed);
+	static constexpr Interests all_interests = (1u << state_change_count) - 1;
+	using PersonObserver = Observer<Person, StateChange>;
+	explicit Person(std::string forename, std::string surname) : forename_{std::move(forename)}, surname_{std::move(surname)} {}
+	// an observer is attached once, detach first to change its interests
+	bool attach(PersonObserver*, Interests = all_interests);
+	bool detach(PersonObserver*);
+	void notify(StateChange);
+	void forename(std::string);
+	void surname(std::string);
+	void address(std::string);
+	const std::string& forename() const { return forename_; }
+	const std::string& surname() const { return surname_; }
+	const std::string& address() const { return address_; }
+	private:
+	bool is_attached(PersonObserver*) const;
+	std::string forename_;
+	std::string surname_;
+	std::string address_;
+	// one list per state change, an observer is in every list it is interested in
+	std::array<std::vector<PersonObserver*>, state_change_count> observers_;
+};
+
+bool Person::is_attached(PersonObserver* observer) const
+{
+	return std::any_of(observers_.begin(), observers_.end(), [observer](const auto& list) {
+		return std::find(list.begin(), list.end(), observer) != list.end();
+	});
+}
+
+bool Person::attach(PersonObserver* observer, Interests interests)
+{
+	if((interests & all_interests) == 0 || is_attached(observer)) return false;
+	for(std::size_t property = 0; property < state_change_count; ++property)
+	{
+		if(interests & interest(static_cast<StateChange>(property))) { observers_[property].push_back(observer); }
+	}
+	return true;
+}
+
+bool Person::detach(PersonObserver* observer)
+{
+	bool detached = false;
+	for(auto& list : observers_)
+	{
+		if(const auto position = std::find(list.begin(), list.end(), observer); position != list.end())
+		{	// keeps the attach order
+			list.erase(position);
+			detached = true;
+		}
+	}
+	return detached;
+}
+
+void Person::notify(StateChange property)
+{	// only the observers interested in this change are visited
+	for(const auto& observer : observers_[property])
+	{
+		observer->update(*this, property);
+	}
+}
+
+void Person::forename(std::string forename)
+{
+	forename_ = std::move(forename);
+	notify(forename_changed);
+}
+
+void Person::surname(std::string surname)
+{
+	surname_ = std::move(surname);
+	notify(surname_changed);
+}
+
+void Person::address(std::string address)
+{
+	address_ = std::move(address);
+	notify(address_changed);
+}
+
+void on_name_update(const Person& person, Person::StateChange)
+{	// no need to check the property anymore
+	std::cout << "Updated name of the person is " << person.forename() << " " << person.surname() << "!\n";
+}
+
+void on_address_update(const Person& person, Person::StateChange)
+{
+	std::cout << "Address of " << person.forename() << " " << person.surname() << " has been changed!\n";
+}
+
+template<class Function>
+double elapsed_ms(Function function)
+{
+	const auto start = std::chrono::steady_clock::now();
+	function();
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main()
+{
+	Person::PersonObserver name_observer{on_name_update};
+	Person::PersonObserver address_observer{on_address_update};
+
+	Person tony("Tony", "Stark");
+	Person alanna("Alanna", "Mitsopolis");
+
+	tony.attach(&name_observer, Person::name_interests);
+	alanna.attach(&name_observer, Person::name_interests);
+	alanna.attach(&address_observer, Person::interest(Person::address_changed));
+
+	tony.forename("Tony Ironman");
+	alanna.forename("Alanna White-Widow");
+
+	tony.address("Stark Industries");
+	alanna.address("Earth");
+
+	// benchmark with 100 observers, each one interested in a single field except every tenth
+	// broadcast: every observer is attached to all changes and filters in its callback (as in functional_observer.cpp)
+	constexpr std::size_t observer_count = 100;
+	constexpr std::size_t updates = 200000;
+	std::size_t useful = 0, calls = 0;
+	std::vector<Person::PersonObserver> masked, broadcast;
+	std::vector<Person::Interests> interests;
+	for(std::size_t i = 0; i < observer_count; ++i)
+	{
+		const auto wanted = (i % 10 == 0) ? Person::all_interests : Person::interest(static_cast<Person::StateChange>(i % Person::state_change_count));
+		interests.push_back(wanted);
+		masked.emplace_back([&useful](const Person&, Person::StateChange) { ++useful; });
+		broadcast.emplace_back([&useful, &calls, wanted](const Person&, Person::StateChange property) {
+			++calls;
+			if(wanted & Person::interest(property)) { ++useful; }
+		});
+	}
+	Person masked_person("Peter", "Parker"), broadcast_person("Peter", "Parker");
+	for(std::size_t i = 0; i < observer_count; ++i)
+	{
+		masked_person.attach(&masked[i], interests[i]);
+		broadcast_person.attach(&broadcast[i]);
+	}
+	const auto run = [](Person& person) {
+		for(std::size_t i = 0; i < updates; ++i)
+		{
+			person.notify(static_cast<Person::StateChange>(i % Person::state_change_count));
+		}
+	};
+	const double broadcast_ms = elapsed_ms([&] { run(broadcast_person); });
+	const std::size_t broadcast_useful = useful;
+	useful = 0;
+	const double masked_ms = elapsed_ms([&] { run(masked_person); });
+	std::cout << "broadcast : " << broadcast_ms << " ms, " << calls << " callbacks, " << broadcast_useful << " useful\n";
+	std::cout << "masked    : " << masked_ms << " ms, " << useful << " callbacks, " << useful << " useful\n";
+	return 0;
+}
@@ -0,0 +1,439 @@
+// Reference:
+// Klaus Iglberg.
+// C++ Software Design.
+// Design principles and patterns for high-quality software.
+
+// Functional observer for a registry of many persons stored column by column.
+// Observers are attached to the registry, not to each person, and are notified with batches of changes.
+
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <set>
+#include <array>
+#include <vector>
+#include <span>
+#include <memory>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <random>
+#include <chrono>
+
+template<class Observed, class StateTag>
+class Observer
+{
+	public:
+	using callback_type = std::function<void(const Observed&, StateTag)>;
+	explicit Observer(callback_type callback) : callback_{std::move(callback)} {}
+	void update(const Observed& observed, StateTag property)
+	{
+		callback_(observed, property);
+	}
+	private:
+	callback_type callback_;
+};
+
+class StringPool
+{	// interns strings, equal strings are stored once in an arena and referred to by a 32 bit id
+	public:
+	using Id = std::uint32_t;
+	static std::size_t hash(std::string_view string) { return std::hash<std::string_view>{}(string); }
+	Id intern(std::string_view string) { return intern(string, hash(string)); }
+	// with the hash computed before, see prefetch
+	Id intern(std::string_view, std::size_t hash);
+	// room for count strings in the hash table, so that interning them does not rehash
+	void reserve(std::size_t count);
+	// bulk interning hides the cache misses of a lookup by announcing the hash early, in two steps:
+	// prefetch_slot a few lookups ahead, then prefetch_string, which reads the by then cached slot
+	void prefetch_slot(std::size_t hash) const { __builtin_prefetch(&slots_[hash & (slots_.size() - 1)]); }
+	void prefetch_string(std::size_t hash) const;
+	std::string_view operator[](Id id) const { return views_[id]; }
+	std::size_t size() const { return views_.size(); }
+	// approximate number of bytes in use, including the hash table
+	std::size_t memory() const;
+	private:
+	std::string_view store(std::string_view);
+	void grow();
+	static constexpr std::size_t chunk_size = 64 * 1024;
+	static constexpr Id empty_slot = UINT32_MAX;
+	std::vector<std::unique_ptr<char[]>> chunks_;
+	char* current_chunk_ = nullptr;
+	std::size_t chunk_used_ = chunk_size;
+	std::size_t arena_bytes_ = 0;
+	std::vector<std::string_view> views_;
+	// open addressing with linear probing, a slot holds the id and a part of the hash to skip most comparisons
+	struct Slot
+	{
+		Id id = empty_slot;
+		std::uint32_t hash = 0;
+	};
+	std::vector<Slot> slots_ = std::vector<Slot>(1024);
+};
+
+StringPool::Id StringPool::intern(std::string_view string, std::size_t hash)
+{
+	const std::size_t mask = slots_.size() - 1;
+	std::size_t index = hash & mask;
+	for(; slots_[index].id != empty_slot; index = (index + 1) & mask)
+	{
+		if(slots_[index].hash == static_cast<std::uint32_t>(hash) && views_[slots_[index].id] == string) return slots_[index].id;
+	}
+	const auto id = static_cast<Id>(views_.size());
+	views_.push_back(store(string));
+	slots_[index] = Slot{id, static_cast<std::uint32_t>(hash)};
+	// keeps the load factor below one half
+	if(2 * views_.size() > slots_.size()) { grow(); }
+	return id;
+}
+
+void StringPool::prefetch_string(std::size_t hash) const
+{	// only the first slot probed, which is where most strings are found
+	const Slot& slot = slots_[hash & (slots_.size() - 1)];
+	if(slot.id != empty_slot && slot.hash == static_cast<std::uint32_t>(hash)) { __builtin_prefetch(views_[slot.id].data()); }
+}
+
+void StringPool::reserve(std::size_t count)
+{
+	while(2 * count > slots_.size()) { grow(); }
+}
+
+void StringPool::grow()
+{
+	std::vector<Slot> slots(2 * slots_.size());
+	const std::size_t mask = slots.size() - 1;
+	for(Id id = 0; id < views_.size(); ++id)
+	{
+		const std::size_t hash = std::hash<std::string_view>{}(views_[id]);
+		std::size_t index = hash & mask;
+		while(slots[index].id != empty_slot) { index = (index + 1) & mask; }
+		slots[index] = Slot{id, static_cast<std::uint32_t>(hash)};
+	}
+	slots_.swap(slots);
+}
+
+std::string_view StringPool::store(std::string_view string)
+{	// views stay valid since chunks never move, strings longer than a chunk get their own one
+	char* destination;
+	if(string.size() > chunk_size)
+	{
+		chunks_.push_back(std::make_unique<char[]>(string.size()));
+		arena_bytes_ += string.size();
+		destination = chunks_.back().get();
+	}
+	else
+	{
+		if(string.size() > chunk_size - chunk_used_)
+		{
+			chunks_.push_back(std::make_unique<char[]>(chunk_size));
+			arena_bytes_ += chunk_size;
+			current_chunk_ = chunks_.back().get();
+			chunk_used_ = 0;
+		}
+		destination = current_chunk_ + chunk_used_;
+		chunk_used_ += string.size();
+	}
+	if(!string.empty()) { std::memcpy(destination, string.data(), string.size()); }
+	return {destination, string.size()};
+}
+
+std::size_t StringPool::memory() const
+{
+	return arena_bytes_ + views_.capacity() * sizeof(std::string_view) + slots_.capacity() * sizeof(Slot);
+}
+
+class PersonRegistry
+{
+	public:
+	using PersonId = std::uint32_t;
+	enum StateChange
+	{
+		forename_changed,
+		surname_changed,
+		address_changed
+	};
+	struct Change
+	{
+		PersonId person;
+		StateChange property;
+	};
+	struct Update
+	{
+		PersonId person;
+		StateChange property;
+		std::string_view value;
+	};
+	using Changes = std::span<const Change>;
+	using RegistryObserver = Observer<PersonRegistry, Changes>;
+	class BatchUpdate;
+	PersonRegistry() { strings_.intern(""); }
+	PersonId add(std::string_view forename, std::string_view surname);
+	void reserve(std::size_t);
+	bool attach(RegistryObserver*);
+	bool detach(RegistryObserver*);
+	void notify(Changes);
+	// changes within the scope are delivered as a single batch when the scope ends
+	[[nodiscard]] BatchUpdate batch_update();
+	// bulk update, observers are notified once with all changes
+	void update(std::span<const Update>);
+	void forename(PersonId person, std::string_view forename) { set(person, forename_changed, forename); }
+	void surname(PersonId person, std::string_view surname) { set(person, surname_changed, surname); }
+	void address(PersonId person, std::string_view address) { set(person, address_changed, address); }
+	std::string_view forename(PersonId person) const { return strings_[columns_[forename_changed][person]]; }
+	std::string_view surname(PersonId person) const { return strings_[columns_[surname_changed][person]]; }
+	std::string_view address(PersonId person) const { return strings_[columns_[address_changed][person]]; }
+	std::size_t size() const { return columns_[forename_changed].size(); }
+	// approximate number of bytes in use
+	std::size_t memory() const;
+	private:
+	void set(PersonId, StateChange, std::string_view);
+	StringPool strings_;
+	// one column per field, indexed by StateChange
+	std::array<std::vector<StringPool::Id>, 3> columns_;
+	std::set<RegistryObserver*> observers_;
+	unsigned batch_depth_ = 0;
+	std::vector<Change> pending_;
+	// scratch space of update
+	std::vector<std::size_t> hashes_;
+};
+
+class PersonRegistry::BatchUpdate
+{	// RAII, batches can be nested and only the outermost one notifies
+	public:
+	explicit BatchUpdate(PersonRegistry& registry) : registry_{&registry} { ++registry_->batch_depth_; }
+	BatchUpdate(const BatchUpdate&) = delete;
+	BatchUpdate& operator=(const BatchUpdate&) = delete;
+	~BatchUpdate();
+	private:
+	PersonRegistry* registry_;
+};
+
+PersonRegistry::BatchUpdate::~BatchUpdate()
+{	// note that an observer throwing from here would terminate the program
+	if(--registry_->batch_depth_ != 0 || registry_->pending_.empty()) return;
+	registry_->notify(registry_->pending_);
+	registry_->pending_.clear();
+}
+
+PersonRegistry::BatchUpdate PersonRegistry::batch_update()
+{
+	return BatchUpdate{*this};
+}
+
+PersonRegistry::PersonId PersonRegistry::add(std::string_view forename, std::string_view surname)
+{
+	const auto person = static_cast<PersonId>(size());
+	columns_[forename_changed].push_back(strings_.intern(forename));
+	columns_[surname_changed].push_back(strings_.intern(surname));
+	columns_[address_changed].push_back(0);
+	return person;
+}
+
+void PersonRegistry::reserve(std::size_t count)
+{
+	for(auto& column : columns_) { column.reserve(count); }
+}
+
+bool PersonRegistry::attach(RegistryObserver* observer)
+{
+	auto [pos, success] = observers_.insert(observer);
+	return success;
+}
+
+bool PersonRegistry::detach(RegistryObserver* observer)
+{
+	return (observers_.erase(observer)) > 0;
+}
+
+void PersonRegistry::notify(Changes changes)
+{
+	for(const auto& observer : observers_)
+	{
+		observer->update(*this, changes);
+	}
+}
+
+void PersonRegistry::set(PersonId person, StateChange property, std::string_view value)
+{
+	columns_[property][person] = strings_.intern(value);
+	if(batch_depth_ == 0)
+	{
+		const Change change{person, property};
+		notify(Changes{&change, 1});
+	}
+	else { pending_.push_back(Change{person, property}); }
+}
+
+void PersonRegistry::update(std::span<const Update> updates)
+{	// the hashes are computed first, then each lookup prefetches the ones ahead of it
+	// so that the cache misses in the hash table and in the arena overlap instead of adding up
+	constexpr std::size_t slot_distance = 16, string_distance = 8;
+	auto batch = batch_update();
+	pending_.reserve(pending_.size() + updates.size());
+	strings_.reserve(strings_.size() + updates.size());
+	hashes_.resize(updates.size());
+	for(std::size_t i = 0; i < updates.size(); ++i)
+	{
+		if(i + slot_distance < updates.size()) { __builtin_prefetch(updates[i + slot_distance].value.data()); }
+		hashes_[i] = StringPool::hash(updates[i].value);
+	}
+	for(std::size_t i = 0; i < updates.size(); ++i)
+	{
+		if(i + slot_distance < updates.size()) { strings_.prefetch_slot(hashes_[i + slot_distance]); }
+		if(i + string_distance < updates.size()) { strings_.prefetch_string(hashes_[i + string_distance]); }
+		const Update& update = updates[i];
+		columns_[update.property][update.person] = strings_.intern(update.value, hashes_[i]);
+		pending_.push_back(Change{update.person, update.property});
+	}
+}
+
+std::size_t PersonRegistry::memory() const
+{
+	std::size_t bytes = sizeof(*this) + strings_.memory();
+	for(const auto& column : columns_) { bytes += column.capacity() * sizeof(StringPool::Id); }
+	return bytes;
+}
+
+class Person
+{	// same as in functional_observer.cpp, used as the baseline
+	public:
+	enum StateChange
+	{
+		forename_changed,
+		surname_changed,
+		address_changed
+	};
+	using PersonObserver = Observer<Person, StateChange>;
+	explicit Person(std::string forename, std::string surname) : forename_{std::move(forename)}, surname_{std::move(surname)} {}
+	bool attach(PersonObserver* observer) { return observers_.insert(observer).second; }
+	void notify(StateChange property) { for(const auto& observer : observers_) { observer->update(*this, property); } }
+	void address(std::string address) { address_ = std::move(address); notify(address_changed); }
+	const std::string& forename() const { return forename_; }
+	const std::string& surname() const { return surname_; }
+	const std::string& address() const { return address_; }
+	// approximate number of bytes in use, strings longer than the small string buffer live on the heap
+	std::size_t memory() const;
+	private:
+	std::string forename_;
+	std::string surname_;
+	std::string address_;
+	std::set<PersonObserver*> observers_;
+};
+
+std::size_t Person::memory() const
+{	// a node of std::set holds the color, three pointers and the element
+	constexpr std::size_t node_size = 4 * sizeof(void*) + sizeof(PersonObserver*);
+	const auto heap = [](const std::string& string) { return string.capacity() > 15 ? string.capacity() + 1 : 0; };
+	return sizeof(*this) + heap(forename_) + heap(surname_) + heap(address_) + observers_.size() * node_size;
+}
+
+void on_name_update(const PersonRegistry& registry, PersonRegistry::Changes changes)
+{
+	for(const auto& change : changes)
+	{
+		if(change.property == PersonRegistry::forename_changed || change.property == PersonRegistry::surname_changed)
+		{
+			std::cout << "Updated name of the person is " << registry.forename(change.person) << " " << registry.surname(change.person) << "!\n";
+		}
+	}
+}
+
+void on_address_update(const PersonRegistry& registry, PersonRegistry::Changes changes)
+{
+	for(const auto& change : changes)
+	{
+		if(change.property == PersonRegistry::address_changed)
+		{
+			std::cout << "Address of " << registry.forename(change.person) << " " << registry.surname(change.person) << " has been changed!\n";
+		}
+	}
+}
+
+template<class Function>
+double elapsed_s(Function function)
+{
+	const auto start = std::chrono::steady_clock::now();
+	function();
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main()
+{
+	PersonRegistry::RegistryObserver name_observer{on_name_update};
+	PersonRegistry::RegistryObserver address_observer{on_address_update};
+
+	{
+		PersonRegistry registry;
+		const auto tony = registry.add("Tony", "Stark");
+		const auto alanna = registry.add("Alanna", "Mitsopolis");
+		registry.attach(&name_observer);
+		registry.attach(&address_observer);
+
+		registry.forename(tony, "Tony Ironman");
+		const PersonRegistry::Update updates[] = {
+			{alanna, PersonRegistry::forename_changed, "Alanna White-Widow"},
+			{tony, PersonRegistry::address_changed, "Stark Industries"},
+			{alanna, PersonRegistry::address_changed, "Earth"}
+		};
+		registry.update(updates);
+	}
+
+	// one million persons whose names come from a limited vocabulary, as real names do
+	constexpr std::size_t person_count = 1000000;
+	std::mt19937 engine{42};
+	std::uniform_int_distribution<int> forename_of{0, 999}, surname_of{0, 19999}, street_of{0, 99999};
+	const auto forename = [&] { return "Forename-" + std::to_string(forename_of(engine)); };
+	const auto surname = [&] { return "Surname-" + std::to_string(surname_of(engine)); };
+	const auto address = [&] { return std::to_string(street_of(engine)) + " Long Street Name, Some City"; };
+	std::vector<std::string> addresses(person_count);
+	for(auto& value : addresses) { value = address(); }
+
+	std::size_t changes_seen = 0;
+	PersonRegistry::RegistryObserver counting_registry_observer{[&changes_seen](const PersonRegistry&, PersonRegistry::Changes changes) { changes_seen += changes.size(); }};
+	Person::PersonObserver counting_person_observer{[&changes_seen](const Person&, Person::StateChange) { ++changes_seen; }};
+
+	const auto populate = [&](PersonRegistry& registry) {
+		registry.reserve(person_count);
+		registry.attach(&counting_registry_observer);
+		for(std::size_t i = 0; i < person_count; ++i) { registry.add(forename(), surname()); }
+	};
+	PersonRegistry single_registry;
+	populate(single_registry);
+	const double single_s = elapsed_s([&] {
+		for(std::size_t i = 0; i < person_count; ++i) { single_registry.address(static_cast<PersonRegistry::PersonId>(i), addresses[i]); }
+	});
+	const std::size_t single_changes = changes_seen;
+	changes_seen = 0;
+
+	PersonRegistry registry;
+	populate(registry);
+	std::vector<PersonRegistry::Update> updates(person_count);
+	for(std::size_t i = 0; i < person_count; ++i) { updates[i] = {static_cast<PersonRegistry::PersonId>(i), PersonRegistry::address_changed, addresses[i]}; }
+	const double registry_s = elapsed_s([&] {
+		for(std::size_t begin = 0; begin < person_count; begin += 65536)
+		{
+			registry.update(std::span{updates}.subspan(begin, std::min<std::size_t>(65536, person_count - begin)));
+		}
+	});
+	const std::size_t registry_changes = changes_seen;
+	changes_seen = 0;
+
+	std::vector<Person> persons;
+	persons.reserve(person_count);
+	for(std::size_t i = 0; i < person_count; ++i)
+	{
+		persons.emplace_back(forename(), surname());
+		persons.back().attach(&counting_person_observer);
+	}
+	const double persons_s = elapsed_s([&] {
+		for(std::size_t i = 0; i < person_count; ++i) { persons[i].address(addresses[i]); }
+	});
+	std::size_t persons_memory = persons.capacity() * sizeof(Person);
+	for(const auto& person : persons) { persons_memory += person.memory() - sizeof(Person); }
+
+	std::cout << person_count << " persons, with a single observer\n";
+	std::cout << "  Person objects : " << static_cast<double>(persons_memory) / person_count << " bytes/person, " << person_count / persons_s / 1e6 << " M address updates/s, " << changes_seen << " changes observed\n";
+	std::cout << "  PersonRegistry : " << static_cast<double>(single_registry.memory()) / person_count << " bytes/person, " << person_count / single_s / 1e6 << " M address updates/s, " << single_changes << " changes observed, single updates\n";
+	std::cout << "  PersonRegistry : " << static_cast<double>(registry.memory()) / person_count << " bytes/person, " << person_count / registry_s / 1e6 << " M address updates/s, " << registry_changes << " changes observed, bulk updates\n";
+	return 0;
+}
@@ -0,0 +1,402 @@
+// Reference:
+// Klaus Iglberg.
+// C++ Software Design.
+// Design principles and patterns for high-quality software.
+
+// Functional observer in which observers can be attached and detached from any thread while notifying.
+
+#include <iostream>
+#include <string>
+#include <set>
+#include <array>
+#include <vector>
+#include <algorithm>
+#include <functional>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <chrono>
+#include <cstdint>
+#include <stdexcept>
+
+class EpochDomain
+{	// epoch based reclamation
+	// memory retired at epoch e is freed once no reader is pinned at epoch e or earlier
+	// a single domain per process, since every thread has a single slot, kept in a thread_local
+	public:
+	static EpochDomain& instance()
+	{
+		static EpochDomain domain;
+		return domain;
+	}
+	class Guard;
+	EpochDomain(const EpochDomain&) = delete;
+	EpochDomain& operator=(const EpochDomain&) = delete;
+	~EpochDomain() { for(auto& retired : retired_) { retired.deleter(); } }
+	// deleter runs once the readers which might still see the memory are gone
+	void retire(std::function<void()> deleter);
+	// frees the retired memory no reader can see anymore
+	void collect();
+	// blocks until every reader pinned before the call has left
+	// would wait for itself in a thread that is pinned, inside a notification for instance, so it throws there instead
+	void synchronize();
+	private:
+	EpochDomain() = default;
+	static constexpr std::uint64_t inactive = UINT64_MAX;
+	static constexpr std::size_t max_threads = 128;
+	struct alignas(64) Slot
+	{
+		std::atomic<std::uint64_t> epoch{inactive};
+		std::atomic<bool> owned{false};
+	};
+	struct ThreadState
+	{	// slot is released when the thread exits
+		Slot* slot = nullptr;
+		unsigned depth = 0;
+		~ThreadState() { if(slot != nullptr) slot->owned.store(false, std::memory_order_release); }
+	};
+	struct Retired
+	{
+		std::uint64_t epoch;
+		std::function<void()> deleter;
+	};
+	ThreadState& local_state();
+	std::uint64_t min_pinned_epoch() const;
+	std::atomic<std::uint64_t> epoch_{0};
+	std::array<Slot, max_threads> slots_;
+	std::mutex retired_mutex_;
+	std::vector<Retired> retired_;
+};
+
+class EpochDomain::Guard
+{	// RAII, pins the calling thread to the current epoch, can be nested
+	public:
+	Guard() : state_{instance().local_state()}
+	{	// sequentially consistent so that the pin is visible before anything is read
+		if(state_.depth++ == 0) { state_.slot->epoch.store(instance().epoch_.load()); }
+	}
+	Guard(const Guard&) = delete;
+	Guard& operator=(const Guard&) = delete;
+	~Guard()
+	{
+		if(--state_.depth == 0) { state_.slot->epoch.store(inactive, std::memory_order_release); }
+	}
+	private:
+	ThreadState& state_;
+};
+
+EpochDomain::ThreadState& EpochDomain::local_state()
+{	// works since there is a single domain per process
+	thread_local ThreadState state;
+	if(state.slot != nullptr) return state;
+	for(auto& slot : slots_)
+	{
+		bool owned = false;
+		if(slot.owned.compare_exchange_strong(owned, true, std::memory_order_acquire))
+		{
+			state.slot = &slot;
+			return state;
+		}
+	}
+	throw std::runtime_error("too many threads reading concurrently");
+}
+
+std::uint64_t EpochDomain::min_pinned_epoch() const
+{
+	std::uint64_t minimum = inactive;
+	for(const auto& slot : slots_) { minimum = std::min(minimum, slot.epoch.load()); }
+	return minimum;
+}
+
+void EpochDomain::retire(std::function<void()> deleter)
+{	// readers pinned after the increment cannot see the memory anymore
+	const std::uint64_t epoch = epoch_.fetch_add(1);
+	{
+		std::lock_guard lock{retired_mutex_};
+		retired_.push_back(Retired{epoch, std::move(deleter)});
+	}
+	collect();
+}
+
+void EpochDomain::collect()
+{
+	std::vector<Retired> reclaimable;
+	{
+		std::lock_guard lock{retired_mutex_};
+		const std::uint64_t minimum = min_pinned_epoch();
+		const auto position = std::partition(retired_.begin(), retired_.end(), [minimum](const Retired& retired) { return retired.epoch >= minimum; });
+		std::move(position, retired_.end(), std::back_inserter(reclaimable));
+		retired_.erase(position, retired_.end());
+	}
+	for(auto& retired : reclaimable) { retired.deleter(); }
+}
+
+void EpochDomain::synchronize()
+{
+	if(local_state().depth != 0) throw std::logic_error("synchronize called by a pinned reader");
+	const std::uint64_t epoch = epoch_.fetch_add(1);
+	while(min_pinned_epoch() <= epoch) { std::this_thread::yield(); }
+	collect();
+}
+
+template<class Type>
+class SnapshotList
+{	// readers iterate an immutable snapshot without taking locks
+	// writers copy the snapshot, modify the copy and publish it, the old one is retired to the epoch domain
+	public:
+	using Snapshot = std::vector<Type*>;
+	class ReadView;
+	SnapshotList() : snapshot_{new Snapshot{}} {}
+	SnapshotList(const SnapshotList&) = delete;
+	SnapshotList& operator=(const SnapshotList&) = delete;
+	// no reader is expected to be left when the owner is destroyed
+	~SnapshotList() { delete snapshot_.load(); }
+	bool insert(Type*);
+	bool erase(Type*);
+	ReadView read() const { return ReadView{*this}; }
+	private:
+	template<class Modification> bool publish(Modification);
+	std::atomic<Snapshot*> snapshot_;
+	std::mutex writer_mutex_;
+};
+
+template<class Type>
+class SnapshotList<Type>::ReadView
+{	// keeps the snapshot alive while iterating
+	public:
+	explicit ReadView(const SnapshotList& list) : snapshot_{list.snapshot_.load()} {}
+	typename Snapshot::const_iterator begin() const { return snapshot_->begin(); }
+	typename Snapshot::const_iterator end() const { return snapshot_->end(); }
+	private:
+	// guard is constructed (pinned) before the snapshot is loaded
+	EpochDomain::Guard guard_;
+	const Snapshot* snapshot_;
+};
+
+template<class Type>
+template<class Modification>
+bool SnapshotList<Type>::publish(Modification modify)
+{
+	std::lock_guard lock{writer_mutex_};
+	auto copy = std::make_unique<Snapshot>(*snapshot_.load(std::memory_order_relaxed));
+	if(!modify(*copy)) return false;
+	Snapshot* old = snapshot_.exchange(copy.release());
+	EpochDomain::instance().retire([old] { delete old; });
+	return true;
+}
+
+template<class Type>
+bool SnapshotList<Type>::insert(Type* element)
+{
+	return publish([element](Snapshot& snapshot) {
+		const auto position = std::lower_bound(snapshot.begin(), snapshot.end(), element);
+		if(position != snapshot.end() && *position == element) return false;
+		snapshot.insert(position, element);
+		return true;
+	});
+}
+
+template<class Type>
+bool SnapshotList<Type>::erase(Type* element)
+{
+	return publish([element](Snapshot& snapshot) {
+		const auto position = std::lower_bound(snapshot.begin(), snapshot.end(), element);
+		if(position == snapshot.end() || *position != element) return false;
+		snapshot.erase(position);
+		return true;
+	});
+}
+
+template<class Observed, class StateTag>
+class Observer
+{
+	public:
+	using callback_type = std::function<void(const Observed&, StateTag)>;
+	explicit Observer(callback_type callback) : callback_{std::move(callback)} {}
+	void update(const Observed& observed, StateTag property)
+	{
+		callback_(observed, property);
+	}
+	private:
+	callback_type callback_;
+};
+
+class Person
+{
+	public:
+	enum StateChange
+	{
+		forename_changed,
+		surname_changed,
+		address_changed
+	};
+	using PersonObserver = Observer<Person, StateChange>;
+	explicit Person(std::string forename, std::string surname) : forename_{std::move(forename)}, surname_{std::move(surname)} {}
+	// attach and detach are safe to be called from any thread, also from within an update
+	bool attach(PersonObserver*);
+	// a notification which started before detach may still update the observer,
+	// call synchronize before destroying a detached observer, never from inside a notification
+	bool detach(PersonObserver*);
+	void synchronize() const { EpochDomain::instance().synchronize(); }
+	void notify(StateChange) const;
+	void forename(std::string);
+	void surname(std::string);
+	void address(std::string);
+	const std::string& forename() const { return forename_; }
+	const std::string& surname() const { return surname_; }
+	const std::string& address() const { return address_; }
+	private:
+	std::string forename_;
+	std::string surname_;
+	std::string address_;
+	SnapshotList<PersonObserver> observers_;
+};
+
+bool Person::attach(PersonObserver* observer)
+{
+	return observers_.insert(observer);
+}
+
+bool Person::detach(PersonObserver* observer)
+{
+	return observers_.erase(observer);
+}
+
+void Person::notify(StateChange property) const
+{	// iterates the snapshot taken at the beginning, detach during iteration does not invalidate it
+	for(const auto& observer : observers_.read())
+	{
+		observer->update(*this, property);
+	}
+}
+
+void Person::forename(std::string forename)
+{
+	forename_ = std::move(forename);
+	notify(forename_changed);
+}
+
+void Person::surname(std::string surname)
+{
+	surname_ = std::move(surname);
+	notify(surname_changed);
+}
+
+void Person::address(std::string address)
+{
+	address_ = std::move(address);
+	notify(address_changed);
+}
+
+void on_name_update(const Person& person, Person::StateChange property)
+{
+	if(property == Person::forename_changed || property == Person::surname_changed)
+	{
+		std::cout << "Updated name of the person is " << person.forename() << " " << person.surname() << "!\n";
+	}
+}
+
+void on_address_update(const Person& person, Person::StateChange property)
+{
+	if(property == Person::address_changed)
+	{
+		std::cout << "Address of " << person.forename() << " " << person.surname() << " has been changed!\n";
+	}
+}
+
+template<class Type>
+class LockedList
+{	// baseline for the benchmark, std::set guarded by a mutex
+	public:
+	class ReadView
+	{
+		public:
+		explicit ReadView(const LockedList& list) : lock_{list.mutex_}, set_{list.set_} {}
+		auto begin() const { return set_.begin(); }
+		auto end() const { return set_.end(); }
+		private:
+		std::unique_lock<std::mutex> lock_;
+		const std::set<Type*>& set_;
+	};
+	bool insert(Type* element) { std::lock_guard lock{mutex_}; return set_.insert(element).second; }
+	bool erase(Type* element) { std::lock_guard lock{mutex_}; return set_.erase(element) > 0; }
+	ReadView read() const { return ReadView{*this}; }
+	private:
+	mutable std::mutex mutex_;
+	std::set<Type*> set_;
+};
+
+template<class List>
+void benchmark(const char* title, std::size_t reader_count)
+{	// readers notify as fast as they can while a writer keeps attaching and detaching
+	using PersonObserver = Person::PersonObserver;
+	std::vector<PersonObserver> observers(4, PersonObserver{[](const Person&, Person::StateChange) {}});
+	PersonObserver toggled{[](const Person&, Person::StateChange) {}};
+	const Person person("Peter", "Parker");
+	List list;
+	for(auto& observer : observers) { list.insert(&observer); }
+	std::atomic<bool> stop{false};
+	std::atomic<std::size_t> notifications{0}, modifications{0};
+	std::vector<std::thread> threads;
+	for(std::size_t i = 0; i < reader_count; ++i)
+	{
+		threads.emplace_back([&] {
+			std::size_t count = 0;
+			while(!stop.load(std::memory_order_relaxed))
+			{
+				for(const auto& observer : list.read()) { observer->update(person, Person::address_changed); }
+				++count;
+			}
+			notifications += count;
+		});
+	}
+	threads.emplace_back([&] {
+		std::size_t count = 0;
+		while(!stop.load(std::memory_order_relaxed))
+		{
+			list.insert(&toggled);
+			list.erase(&toggled);
+			count += 2;
+		}
+		modifications += count;
+	});
+	std::this_thread::sleep_for(std::chrono::milliseconds(300));
+	stop = true;
+	for(auto& thread : threads) { thread.join(); }
+	std::cout << "  " << title << ": " << notifications / 0.3 / 1e6 << " M notify/s, " << modifications / 0.3 / 1e6 << " M attach+detach/s\n";
+}
+
+int main()
+{
+	Person::PersonObserver name_observer{on_name_update};
+	Person::PersonObserver address_observer{on_address_update};
+
+	Person tony("Tony", "Stark");
+	Person alanna("Alanna", "Mitsopolis");
+
+	tony.attach(&name_observer);
+	alanna.attach(&name_observer);
+	alanna.attach(&address_observer);
+
+	{	// observer detaching itself during notification
+		Person::PersonObserver once{[&once](const Person& person, Person::StateChange) {
+			std::cout << "Notified once\n";
+			const_cast<Person&>(person).detach(&once);
+		}};
+		tony.attach(&once);
+		tony.forename("Tony Ironman");
+		tony.address("Stark Industries");
+		tony.synchronize();
+	}
+	alanna.forename("Alanna White-Widow");
+	alanna.address("Earth");
+
+	// contention benchmark
+	for(std::size_t readers : {1, 2, 4})
+	{
+		std::cout << readers << " notifying thread(s) and 1 attaching/detaching thread\n";
+		benchmark<LockedList<Person::PersonObserver>>("mutex + std::set", readers);
+		benchmark<SnapshotList<Person::PersonObserver>>("snapshot + epoch", readers);
+	}
+	return 0;
+}
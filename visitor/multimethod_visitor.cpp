@@ -0,0 +1,295 @@
+// Reference:
+// Klaus Iglberg.
+// C++ Software Design.
+// Design principles and patterns for high-quality software.
+
+#include <iostream>
+#include <variant>
+#include <vector>
+#include <array>
+#include <algorithm>
+#include <utility>
+#include <span>
+#include <numbers>
+#include <cmath>
+#include <chrono>
+#include <random>
+#include <stdexcept>
+#include <type_traits>
+
+class Circle
+{
+	public:
+	explicit Circle(double radius) : radius_{radius} {
+		// check if the value is valid
+	}
+	inline double radius() const
+	{
+		return radius_;
+	}
+	private:
+	double radius_;
+};
+
+class Square
+{
+	public:
+	explicit Square(double side) : side_{side} {
+		// check if the value is valid
+	}
+	inline double side() const
+	{
+		return side_;
+	}
+	private:
+	double side_;
+};
+
+template<class Result, class Variant> class Multimethod;
+
+template<class Result, class ...Types>
+class Multimethod<Result, std::variant<Types...>>
+{	// double dispatch through a dense table indexed by the type tags (variant indices) of both arguments
+	public:
+	using variant_type = std::variant<Types...>;
+	static constexpr std::size_t type_count = sizeof...(Types);
+	Multimethod() { table_.fill(&unregistered); batch_table_.fill(&unregistered_batch); }
+	// callables have to be stateless (e.g. captureless lambdas) so that no storage is needed per entry
+	template<class Lhs, class Rhs, class Callable> void add(Callable);
+	template<class Lhs, class Rhs, class Callable> void add_symmetric(Callable);
+	// registers every pair the overload set of the callable can be invoked with
+	template<class Callable> void add_all(Callable) { (add_row<Types, Callable>(), ...); }
+	Result operator()(const variant_type& lhs, const variant_type& rhs) const
+	{
+		return table_[checked_cell(lhs, rhs)](lhs, rhs);
+	}
+	// batched entry point, results[i] = (*this)(lhs[i], rhs[i])
+	void operator()(std::span<const variant_type> lhs, std::span<const variant_type> rhs, std::span<Result> results) const;
+	private:
+	using entry_type = Result(*)(const variant_type&, const variant_type&);
+	using batch_entry_type = std::size_t(*)(const variant_type*, const variant_type*, std::size_t, Result*);
+	static constexpr std::size_t cell_count = type_count * type_count;
+	static constexpr std::size_t cell(std::size_t lhs, std::size_t rhs) { return lhs * type_count + rhs; }
+	static std::size_t checked_cell(const variant_type& lhs, const variant_type& rhs)
+	{	// a valueless variant has index variant_npos, which would read past the table
+		if(lhs.valueless_by_exception() || rhs.valueless_by_exception()) throw std::bad_variant_access{};
+		return cell(lhs.index(), rhs.index());
+	}
+	template<class Type> static constexpr std::size_t index_of();
+	template<class Lhs, class Callable> void add_row() { (add_if_invocable<Lhs, Types, Callable>(), ...); }
+	template<class Lhs, class Rhs, class Callable> void add_if_invocable();
+	template<class Lhs, class Rhs, class Callable> static Result dispatch(const variant_type&, const variant_type&);
+	template<class Lhs, class Rhs, class Callable> static std::size_t dispatch_batch(const variant_type*, const variant_type*, std::size_t, Result*);
+	static Result unregistered(const variant_type&, const variant_type&);
+	static std::size_t unregistered_batch(const variant_type*, const variant_type*, std::size_t, Result*);
+	std::array<entry_type, cell_count> table_;
+	std::array<batch_entry_type, cell_count> batch_table_;
+};
+
+template<class Result, class ...Types>
+template<class Type>
+constexpr std::size_t Multimethod<Result, std::variant<Types...>>::index_of()
+{
+	static_assert((std::is_same_v<Type, Types> || ...), "type is not an alternative of the variant");
+	std::size_t index = 0;
+	((std::is_same_v<Type, Types> ? false : (++index, true)) && ...);
+	return index;
+}
+
+template<class Result, class ...Types>
+template<class Lhs, class Rhs, class Callable>
+void Multimethod<Result, std::variant<Types...>>::add(Callable)
+{
+	static_assert(std::is_empty_v<Callable> && std::is_default_constructible_v<Callable>, "callable has to be stateless");
+	static_assert(std::is_invocable_r_v<Result, const Callable&, const Lhs&, const Rhs&>, "callable cannot be invoked with this pair");
+	table_[cell(index_of<Lhs>(), index_of<Rhs>())] = &dispatch<Lhs, Rhs, Callable>;
+	batch_table_[cell(index_of<Lhs>(), index_of<Rhs>())] = &dispatch_batch<Lhs, Rhs, Callable>;
+}
+
+template<class Result, class ...Types>
+template<class Lhs, class Rhs, class Callable>
+void Multimethod<Result, std::variant<Types...>>::add_symmetric(Callable callable)
+{
+	struct Swapped
+	{
+		Result operator()(const Rhs& rhs, const Lhs& lhs) const { return Callable{}(lhs, rhs); }
+	};
+	add<Lhs, Rhs>(callable);
+	if constexpr(!std::is_same_v<Lhs, Rhs>) { add<Rhs, Lhs>(Swapped{}); }
+}
+
+template<class Result, class ...Types>
+template<class Lhs, class Rhs, class Callable>
+void Multimethod<Result, std::variant<Types...>>::add_if_invocable()
+{
+	if constexpr(std::is_invocable_r_v<Result, const Callable&, const Lhs&, const Rhs&>) { add<Lhs, Rhs>(Callable{}); }
+}
+
+template<class Result, class ...Types>
+template<class Lhs, class Rhs, class Callable>
+Result Multimethod<Result, std::variant<Types...>>::dispatch(const variant_type& lhs, const variant_type& rhs)
+{
+	return Callable{}(*std::get_if<Lhs>(&lhs), *std::get_if<Rhs>(&rhs));
+}
+
+template<class Result, class ...Types>
+template<class Lhs, class Rhs, class Callable>
+std::size_t Multimethod<Result, std::variant<Types...>>::dispatch_batch(const variant_type* lhs, const variant_type* rhs, std::size_t count, Result* results)
+{	// the callable is known here, so it is inlined into the loop instead of being called indirectly per pair
+	// processes pairs as long as they are of these types and returns how many were processed
+	const Callable callable{};
+	std::size_t i = 0;
+	for(const Lhs* l; i < count && (l = std::get_if<Lhs>(lhs + i)) != nullptr; ++i)
+	{
+		const Rhs* r = std::get_if<Rhs>(rhs + i);
+		if(r == nullptr) break;
+		results[i] = callable(*l, *r);
+	}
+	return i;
+}
+
+template<class Result, class ...Types>
+Result Multimethod<Result, std::variant<Types...>>::unregistered(const variant_type&, const variant_type&)
+{
+	throw std::logic_error("no overload registered for this pair of types");
+}
+
+template<class Result, class ...Types>
+std::size_t Multimethod<Result, std::variant<Types...>>::unregistered_batch(const variant_type*, const variant_type*, std::size_t, Result*)
+{
+	throw std::logic_error("no overload registered for this pair of types");
+}
+
+template<class Result, class ...Types>
+void Multimethod<Result, std::variant<Types...>>::operator()(std::span<const variant_type> lhs, std::span<const variant_type> rhs, std::span<Result> results) const
+{	// consecutive pairs of the same types are handed to their typed loop at once,
+	// so inputs grouped by type pay for one indirect call per run instead of one per pair
+	if(lhs.size() != rhs.size() || lhs.size() != results.size())
+	{
+		throw std::invalid_argument("sizes of the arguments and results do not match");
+	}
+	for(std::size_t begin = 0; begin < lhs.size();)
+	{
+		const std::size_t c = checked_cell(lhs[begin], rhs[begin]);
+		begin += batch_table_[c](lhs.data() + begin, rhs.data() + begin, lhs.size() - begin, results.data() + begin);
+	}
+}
+
+struct CombinedArea
+{
+	double operator()(const Circle& a, const Circle& b) const
+	{
+		return std::numbers::pi_v<double> * (a.radius() * a.radius() + b.radius() * b.radius());
+	}
+	double operator()(const Circle& c, const Square& s) const
+	{
+		return std::numbers::pi_v<double> * c.radius() * c.radius() + s.side() * s.side();
+	}
+	double operator()(const Square& s, const Circle& c) const
+	{
+		return (*this)(c, s);
+	}
+	double operator()(const Square& a, const Square& b) const
+	{
+		return a.side() * a.side() + b.side() * b.side();
+	}
+};
+
+using Shape = std::variant<Circle, Square>;
+using Shapes = std::vector<Shape>;
+
+Shapes random_shapes(std::size_t count, unsigned seed)
+{
+	std::mt19937 engine{seed};
+	std::uniform_real_distribution<double> length{0.5, 5.0};
+	std::bernoulli_distribution is_circle{0.5};
+	Shapes shapes;
+	shapes.reserve(count);
+	for(std::size_t i = 0; i < count; ++i)
+	{
+		if(is_circle(engine)) { shapes.emplace_back(Circle{length(engine)}); }
+		else { shapes.emplace_back(Square{length(engine)}); }
+	}
+	return shapes;
+}
+
+template<class Function>
+double elapsed_ms(Function function)
+{
+	const auto start = std::chrono::steady_clock::now();
+	function();
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+void benchmark(const char* title, const Shapes& lhs, const Shapes& rhs, const Multimethod<double, Shape>& combined_area)
+{	// the same table driven and visit driven loops over every pair
+	constexpr int repetitions = 20;
+	std::vector<double> results(lhs.size());
+	double checksum_visit = 0.0, checksum_single = 0.0, checksum_batch = 0.0;
+	const double visit_ms = elapsed_ms([&] {
+		for(int r = 0; r < repetitions; ++r)
+		{
+			for(std::size_t i = 0; i < lhs.size(); ++i) { results[i] = std::visit(CombinedArea{}, lhs[i], rhs[i]); }
+			checksum_visit += results[r];
+		}
+	});
+	const double single_ms = elapsed_ms([&] {
+		for(int r = 0; r < repetitions; ++r)
+		{
+			for(std::size_t i = 0; i < lhs.size(); ++i) { results[i] = combined_area(lhs[i], rhs[i]); }
+			checksum_single += results[r];
+		}
+	});
+	const double batch_ms = elapsed_ms([&] {
+		for(int r = 0; r < repetitions; ++r)
+		{
+			combined_area(lhs, rhs, results);
+			checksum_batch += results[r];
+		}
+	});
+	std::cout << title << "\n";
+	std::cout << "  std::visit           : " << visit_ms << " ms\n";
+	std::cout << "  multimethod (single) : " << single_ms << " ms\n";
+	std::cout << "  multimethod (batch)  : " << batch_ms << " ms\n";
+	std::cout << "  checksums match      : " << (checksum_visit == checksum_single && checksum_single == checksum_batch) << "\n";
+}
+
+int main()
+{
+	// asymmetric operation, registered pair by pair
+	Multimethod<bool, Shape> fits_inside;
+	fits_inside.add<Circle, Circle>([](const Circle& inner, const Circle& outer) { return inner.radius() <= outer.radius(); });
+	fits_inside.add<Circle, Square>([](const Circle& inner, const Square& outer) { return 2.0 * inner.radius() <= outer.side(); });
+	fits_inside.add<Square, Circle>([](const Square& inner, const Circle& outer) { return inner.side() * std::numbers::sqrt2_v<double> <= 2.0 * outer.radius(); });
+	fits_inside.add<Square, Square>([](const Square& inner, const Square& outer) { return inner.side() <= outer.side(); });
+
+	// symmetric operation, mixed pair written once
+	Multimethod<double, Shape> combined_perimeter;
+	combined_perimeter.add<Circle, Circle>([](const Circle& a, const Circle& b) { return 2.0 * std::numbers::pi_v<double> * (a.radius() + b.radius()); });
+	combined_perimeter.add_symmetric<Circle, Square>([](const Circle& c, const Square& s) { return 2.0 * std::numbers::pi_v<double> * c.radius() + 4.0 * s.side(); });
+	combined_perimeter.add<Square, Square>([](const Square& a, const Square& b) { return 4.0 * (a.side() + b.side()); });
+
+	// whole overload set at once
+	Multimethod<double, Shape> combined_area;
+	combined_area.add_all(CombinedArea{});
+
+	std::cout << std::boolalpha << fits_inside(Shape{Square{3.0}}, Shape{Circle{2.5}}) << "\n";
+	std::cout << combined_perimeter(Shape{Square{3.0}}, Shape{Circle{2.5}}) << "\n";
+	std::cout << combined_area(Shape{Circle{2.5}}, Shape{Square{3.0}}) << "\n";
+
+	constexpr std::size_t pair_count = 1 << 20;
+	Shapes lhs = random_shapes(pair_count, 1);
+	Shapes rhs = random_shapes(pair_count, 2);
+	benchmark("random pairs", lhs, rhs, combined_area);
+
+	// grouping the pairs by their types lets the batched entry point run long typed loops
+	std::vector<std::size_t> order(pair_count);
+	for(std::size_t i = 0; i < pair_count; ++i) { order[i] = i; }
+	std::stable_sort(order.begin(), order.end(), [&](std::size_t a, std::size_t b) {
+		return std::pair{lhs[a].index(), rhs[a].index()} < std::pair{lhs[b].index(), rhs[b].index()};
+	});
+	Shapes grouped_lhs, grouped_rhs;
+	for(const auto i : order) { grouped_lhs.push_back(lhs[i]); grouped_rhs.push_back(rhs[i]); }
+	benchmark("pairs grouped by type", grouped_lhs, grouped_rhs, combined_area);
+	return 0;
+}